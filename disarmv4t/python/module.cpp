@@ -0,0 +1,294 @@
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "branch.h"
+#include "disassemble.h"
+#include "window.h"
+
+struct Line
+{
+    u32 addr;
+    u32 instr;
+    std::string mnemonic;
+};
+
+static std::vector<Line> disassembleBuffer(const u8* data, std::size_t size, u32 addr, bool thumb)
+{
+    std::vector<Line> lines;
+
+    if (!thumb)
+    {
+        lines.reserve(size / 4);
+        for (std::size_t index = 0; index + 4 <= size; index += 4)
+        {
+            u32 instr;
+            std::memcpy(&instr, data + index, sizeof(instr));
+
+            lines.push_back({ addr, instr, disassemble(instr, addr + 8) });
+
+            addr += 4;
+        }
+    }
+    else
+    {
+        u32 lr = 0;
+
+        lines.reserve(size / 2);
+        for (std::size_t index = 0; index + 2 <= size; index += 2)
+        {
+            u16 instr;
+            std::memcpy(&instr, data + index, sizeof(instr));
+
+            lines.push_back({ addr, instr, disassemble(instr, addr + 4, lr) });
+
+            lr = thumbLongBranchSetup(instr, addr + 4);
+
+            addr += 2;
+        }
+    }
+    return lines;
+}
+
+static bool parseAddress(long long value, const char* name)
+{
+    if (value >= 0 && value <= 0xFFFFFFFF)
+        return true;
+
+    PyErr_Format(PyExc_ValueError, "%s must be between 0 and 0xFFFFFFFF", name);
+    return false;
+}
+
+static PyObject* disarmv4t_disassemble(PyObject*, PyObject* args, PyObject* kwargs)
+{
+    static const char* kKeywords[] = { "data", "base", "thumb", nullptr };
+
+    Py_buffer buffer;
+    long long base = 0;
+    int thumb = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "y*|Lp", const_cast<char**>(kKeywords), &buffer, &base, &thumb))
+        return nullptr;
+
+    if (!parseAddress(base, "base"))
+    {
+        PyBuffer_Release(&buffer);
+        return nullptr;
+    }
+
+    std::vector<Line> lines;
+
+    Py_BEGIN_ALLOW_THREADS
+    lines = disassembleBuffer(
+        static_cast<const u8*>(buffer.buf),
+        static_cast<std::size_t>(buffer.len),
+        static_cast<u32>(base),
+        thumb);
+    Py_END_ALLOW_THREADS
+
+    PyBuffer_Release(&buffer);
+
+    PyObject* list = PyList_New(static_cast<Py_ssize_t>(lines.size()));
+    if (!list)
+        return nullptr;
+
+    for (std::size_t x = 0; x < lines.size(); ++x)
+    {
+        const auto& line = lines[x];
+
+        PyObject* item = Py_BuildValue(
+            "(kks#)",
+            static_cast<unsigned long>(line.addr),
+            static_cast<unsigned long>(line.instr),
+            line.mnemonic.data(),
+            static_cast<Py_ssize_t>(line.mnemonic.size()));
+
+        if (!item)
+        {
+            Py_DECREF(list);
+            return nullptr;
+        }
+        PyList_SET_ITEM(list, static_cast<Py_ssize_t>(x), item);
+    }
+    return list;
+}
+
+// Wraps a DisasmWindow. The window is not shared between threads, so update
+// keeps the GIL while rendering.
+struct WindowObject
+{
+    PyObject_HEAD
+    DisasmWindow* window;
+};
+
+static PyObject* Window_new(PyTypeObject* type, PyObject* args, PyObject* kwargs)
+{
+    static const char* kKeywords[] = { "before", "after", nullptr };
+
+    unsigned int before = 0;
+    unsigned int after = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "II", const_cast<char**>(kKeywords), &before, &after))
+        return nullptr;
+
+    auto* self = reinterpret_cast<WindowObject*>(type->tp_alloc(type, 0));
+    if (!self)
+        return nullptr;
+
+    self->window = new DisasmWindow(before, after);
+    return reinterpret_cast<PyObject*>(self);
+}
+
+static void Window_dealloc(PyObject* object)
+{
+    auto* self = reinterpret_cast<WindowObject*>(object);
+    delete self->window;
+
+    PyTypeObject* type = Py_TYPE(object);
+    type->tp_free(object);
+    Py_DECREF(type);
+}
+
+static PyObject* Window_update(PyObject* object, PyObject* args, PyObject* kwargs)
+{
+    static const char* kKeywords[] = { "data", "base", "pc", "thumb", nullptr };
+
+    Py_buffer buffer;
+    long long base = 0;
+    long long pc = 0;
+    int thumb = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "y*LL|p", const_cast<char**>(kKeywords), &buffer, &base, &pc, &thumb))
+        return nullptr;
+
+    if (!parseAddress(base, "base") || !parseAddress(pc, "pc"))
+    {
+        PyBuffer_Release(&buffer);
+        return nullptr;
+    }
+
+    auto* self = reinterpret_cast<WindowObject*>(object);
+    uint rendered = self->window->update(
+        static_cast<const u8*>(buffer.buf),
+        static_cast<std::size_t>(buffer.len),
+        static_cast<u32>(base),
+        static_cast<u32>(pc),
+        thumb);
+
+    PyBuffer_Release(&buffer);
+
+    return PyLong_FromUnsignedLong(rendered);
+}
+
+static PyObject* Window_lines(PyObject* object, PyObject*)
+{
+    const auto& lines = reinterpret_cast<WindowObject*>(object)->window->lines();
+
+    PyObject* list = PyList_New(static_cast<Py_ssize_t>(lines.size()));
+    if (!list)
+        return nullptr;
+
+    for (std::size_t x = 0; x < lines.size(); ++x)
+    {
+        const auto& line = lines[x];
+
+        PyObject* item = Py_BuildValue(
+            "(kkNs#)",
+            static_cast<unsigned long>(line.addr),
+            static_cast<unsigned long>(line.instr),
+            PyBool_FromLong(line.thumb),
+            line.mnemonic.data(),
+            static_cast<Py_ssize_t>(line.mnemonic.size()));
+
+        if (!item)
+        {
+            Py_DECREF(list);
+            return nullptr;
+        }
+        PyList_SET_ITEM(list, static_cast<Py_ssize_t>(x), item);
+    }
+    return list;
+}
+
+static PyMethodDef kWindowMethods[] =
+{
+    {
+        "update",
+        reinterpret_cast<PyCFunction>(reinterpret_cast<void(*)()>(Window_update)),
+        METH_VARARGS | METH_KEYWORDS,
+        "update(data, base, pc, thumb=False) -> int\n\n"
+        "Moves the window to pc and returns the number of rendered lines."
+    },
+    {
+        "lines",
+        Window_lines,
+        METH_NOARGS,
+        "lines() -> list[tuple[int, int, bool, str]]\n\n"
+        "Returns the lines of the window."
+    },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PyType_Slot kWindowSlots[] =
+{
+    { Py_tp_new,     reinterpret_cast<void*>(Window_new)     },
+    { Py_tp_dealloc, reinterpret_cast<void*>(Window_dealloc) },
+    { Py_tp_methods, kWindowMethods                          },
+    { Py_tp_doc,     const_cast<char*>(
+        "Window(before, after)\n\n"
+        "Disassembly window around the pc which only renders changed lines.") },
+    { 0, nullptr }
+};
+
+static PyType_Spec kWindowSpec =
+{
+    "disarmv4t.Window",
+    sizeof(WindowObject),
+    0,
+    Py_TPFLAGS_DEFAULT,
+    kWindowSlots
+};
+
+static PyMethodDef kMethods[] =
+{
+    {
+        "disassemble",
+        reinterpret_cast<PyCFunction>(reinterpret_cast<void(*)()>(disarmv4t_disassemble)),
+        METH_VARARGS | METH_KEYWORDS,
+        "disassemble(data, base=0, thumb=False) -> list[tuple[int, int, str]]\n\n"
+        "Disassembles a contiguous buffer without copying it."
+    },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PyModuleDef kModule =
+{
+    PyModuleDef_HEAD_INIT,
+    "disarmv4t",
+    "An ARMv4T disassembler.",
+    -1,
+    kMethods,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr
+};
+
+PyMODINIT_FUNC PyInit_disarmv4t()
+{
+    PyObject* module = PyModule_Create(&kModule);
+    if (!module)
+        return nullptr;
+
+    PyObject* window = PyType_FromSpec(&kWindowSpec);
+    if (!window || PyModule_AddObject(module, "Window", window) < 0)
+    {
+        Py_XDECREF(window);
+        Py_DECREF(module);
+        return nullptr;
+    }
+    return module;
+}
@@ -0,0 +1,241 @@
+#include "annotations.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include <shell/fmt.h>
+
+namespace fs = shell::filesystem;
+
+static constexpr char kMagic[8] = { 'D', 'V', '4', 'T', 'A', 'N', 'N', 'O' };
+static constexpr u32 kVersion = 1;
+static constexpr std::size_t kHeaderSize = 16;
+
+static constexpr std::string_view kKindNames[Annotations::kKindCount] = {
+    "label", "comment", "type"
+};
+
+template<typename T>
+static T load(const u8* data)
+{
+    T value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+Annotations::Annotations(const fs::path& path)
+    : file(path)
+{
+    const u8* data = file.data();
+    std::size_t size = file.size();
+
+    if (size < kHeaderSize || std::memcmp(data, kMagic, sizeof(kMagic)) != 0 || load<u32>(data + 8) != kVersion)
+        return;
+
+    std::size_t offset = kHeaderSize;
+    for (u32 x = load<u32>(data + 12); x > 0; --x)
+    {
+        if (offset > size || size - offset < 8)
+            return;
+
+        u32 count = load<u32>(data + offset);
+        u32 arena = load<u32>(data + offset + 4);
+        offset += 8;
+
+        u64 bytes = u64(count) * sizeof(Entry) + arena;
+        if (size - offset < bytes)
+            return;
+
+        Segment segment;
+        segment.begin = reinterpret_cast<const Entry*>(data + offset);
+        segment.end   = segment.begin + count;
+        segment.arena = reinterpret_cast<const char*>(data + offset + count * sizeof(Entry));
+
+        // Texts are read without further checks, so every entry must lie in its arena
+        for (auto entry = segment.begin; entry != segment.end; ++entry)
+        {
+            if (entry->offset > arena || entry->length > arena - entry->offset)
+                return;
+        }
+        segments.push_back(segment);
+
+        offset += static_cast<std::size_t>((bytes + 3) & ~u64(3));
+    }
+
+    if (offset > size)
+        segments.clear();
+    else
+        valid = true;
+}
+
+bool Annotations::isOpen() const
+{
+    return valid;
+}
+
+bool Annotations::find(u32 addr, Texts& texts) const
+{
+    texts = {};
+
+    bool found = false;
+    for (auto segment = segments.rbegin(); segment != segments.rend(); ++segment)
+    {
+        if (segment->begin == segment->end || addr < segment->begin->addr || addr > segment->end[-1].addr)
+            continue;
+
+        auto entry = std::lower_bound(segment->begin, segment->end, addr, [](const Entry& entry, u32 addr)
+        {
+            return entry.addr < addr;
+        });
+
+        for (; entry != segment->end && entry->addr == addr; ++entry)
+        {
+            if (entry->kind < kKindCount && texts[entry->kind].empty())
+            {
+                texts[entry->kind] = std::string_view(segment->arena + entry->offset, entry->length);
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+
+static bool parseNumber(const std::string& text, u64& value)
+{
+    std::size_t used = 0;
+    try
+    {
+        value = std::stoull(text, &used, 0);
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+    return used == text.size() && text[0] != '-';
+}
+
+bool Annotations::append(const fs::path& path, const fs::path& text)
+{
+    std::ifstream stream(text);
+    if (!stream || !stream.is_open())
+        throw std::runtime_error(fmt::format("Cannot read annotations {}", text));
+
+    // Later lines for the same address and kind replace earlier ones
+    std::map<std::pair<u32, u8>, std::string> lines;
+
+    std::string line;
+    for (uint number = 1; std::getline(stream, line); ++number)
+    {
+        std::istringstream fields(line);
+
+        std::string addr;
+        std::string kind;
+        if (!(fields >> addr) || addr[0] == '#')
+            continue;
+
+        std::string value;
+        fields >> kind >> std::ws;
+        std::getline(fields, value);
+
+        auto name = std::find(std::begin(kKindNames), std::end(kKindNames), kind);
+        if (name == std::end(kKindNames) || value.empty() || value.size() > 0xFFFF)
+            throw std::runtime_error(fmt::format("Bad annotation line {}", number));
+
+        u64 address = 0;
+        if (!parseNumber(addr, address) || address > 0xFFFFFFFF)
+            throw std::runtime_error(fmt::format("Bad number in annotation line {}", number));
+
+        auto key = std::make_pair(static_cast<u32>(address), static_cast<u8>(name - std::begin(kKindNames)));
+        lines[key] = std::move(value);
+    }
+
+    std::vector<Entry> entries;
+    std::string arena;
+    for (const auto& [key, value] : lines)
+    {
+        Entry entry = {};
+        entry.addr   = key.first;
+        entry.kind   = key.second;
+        entry.offset = static_cast<u32>(arena.size());
+        entry.length = static_cast<u16>(value.size());
+        entries.push_back(entry);
+        arena.append(value);
+    }
+
+    u32 count = static_cast<u32>(entries.size());
+    u32 arena_size = static_cast<u32>(arena.size());
+    arena.resize((arena.size() + 3) & ~std::size_t(3), 0);
+
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    if (!file.is_open())
+    {
+        std::ofstream create(path, std::ios::binary);
+        u32 header[2] = { kVersion, 0 };
+        create.write(kMagic, sizeof(kMagic));
+        create.write(reinterpret_cast<const char*>(header), sizeof(header));
+        if (!create)
+            return false;
+
+        create.close();
+        file.open(path, std::ios::binary | std::ios::in | std::ios::out);
+    }
+
+    char header[kHeaderSize];
+    if (!file.read(header, sizeof(header))
+        || std::memcmp(header, kMagic, sizeof(kMagic)) != 0
+        || load<u32>(reinterpret_cast<const u8*>(header + 8)) != kVersion)
+        return false;
+
+    std::error_code ec;
+    u64 size = fs::file_size(path, ec);
+    if (ec)
+        return false;
+
+    // Find the end of the last counted segment, anything after it is left
+    // over from an interrupted append
+    u32 segments = load<u32>(reinterpret_cast<const u8*>(header + 12));
+    u64 end = kHeaderSize;
+    for (u32 x = 0; x < segments; ++x)
+    {
+        u32 sizes[2];
+        if (size - end < sizeof(sizes) || !file.seekg(end) || !file.read(reinterpret_cast<char*>(sizes), sizeof(sizes)))
+            return false;
+
+        end += sizeof(sizes) + ((u64(sizes[0]) * sizeof(Entry) + sizes[1] + 3) & ~u64(3));
+        if (end > size)
+            return false;
+    }
+    segments++;
+
+    if (end < size)
+    {
+        file.close();
+        fs::resize_file(path, end, ec);
+        if (ec)
+            return false;
+
+        file.open(path, std::ios::binary | std::ios::in | std::ios::out);
+        if (!file.is_open())
+            return false;
+    }
+
+    // The segment is complete before the header counts it
+    file.seekp(end);
+    file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    file.write(reinterpret_cast<const char*>(&arena_size), sizeof(arena_size));
+    file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry));
+    file.write(arena.data(), arena.size());
+    file.flush();
+
+    file.seekp(12);
+    file.write(reinterpret_cast<const char*>(&segments), sizeof(segments));
+    file.flush();
+
+    return static_cast<bool>(file);
+}
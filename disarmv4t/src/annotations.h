@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <string_view>
+#include <vector>
+
+#include <shell/filesystem.h>
+
+#include "int.h"
+#include "mapped.h"
+
+// Labels, comments and data types keyed by address. The file is a header
+// followed by segments, each holding entries sorted by address and a string
+// arena. Adding annotations appends a segment, newer segments take priority.
+//
+//   header   "DV4TANNO" u32 version u32 segments
+//   segment  u32 count u32 arena Entry[count] char[arena] padded to 4 bytes
+class Annotations
+{
+public:
+    enum Kind : u8
+    {
+        kKindLabel,
+        kKindComment,
+        kKindType,
+        kKindCount
+    };
+
+    using Texts = std::array<std::string_view, kKindCount>;
+
+    explicit Annotations(const shell::filesystem::path& path);
+
+    bool isOpen() const;
+    bool find(u32 addr, Texts& texts) const;
+
+    // Appends lines "<addr> <label|comment|type> <text>" as a new segment
+    static bool append(const shell::filesystem::path& path, const shell::filesystem::path& text);
+
+private:
+    struct Entry
+    {
+        u32 addr;
+        u32 offset;
+        u16 length;
+        u8 kind;
+        u8 reserved;
+    };
+
+    struct Segment
+    {
+        const Entry* begin;
+        const Entry* end;
+        const char* arena;
+    };
+
+    MappedFile file;
+    bool valid = false;
+    std::vector<Segment> segments;
+};
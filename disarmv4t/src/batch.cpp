@@ -0,0 +1,186 @@
+#include "batch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <shell/fmt.h>
+
+#include "context.h"
+#include "int.h"
+#include "pool.h"
+#include "sink.h"
+#include "source.h"
+
+namespace fs = shell::filesystem;
+
+// Manifest lines are whitespace separated fields, empty lines and lines
+// starting with # are ignored:
+//   <input> <output> <base> <arm|thumb>
+
+struct Job
+{
+    fs::path input;
+    fs::path output;
+    u32 addr = 0;
+    bool thumb = false;
+    u64 size = 0;
+    std::size_t order = 0;
+};
+
+struct Result
+{
+    int status = 0;
+    std::string message;
+};
+
+static std::vector<Job> parseManifest(const fs::path& manifest)
+{
+    std::ifstream stream(manifest);
+    if (!stream || !stream.is_open())
+        throw std::runtime_error(fmt::format("Cannot read manifest {}", manifest));
+
+    std::vector<Job> jobs;
+
+    std::string line;
+    for (uint number = 1; std::getline(stream, line); ++number)
+    {
+        std::istringstream fields(line);
+
+        std::string input;
+        std::string output;
+        std::string base;
+        std::string mode;
+        if (!(fields >> input) || input[0] == '#')
+            continue;
+
+        if (!(fields >> output >> base >> mode) || (mode != "arm" && mode != "thumb"))
+            throw std::runtime_error(fmt::format("Bad manifest line {}", number));
+
+        std::size_t used = 0;
+        unsigned long long addr = 0;
+        try
+        {
+            addr = std::stoull(base, &used, 0);
+        }
+        catch (const std::exception&)
+        {
+            used = 0;
+        }
+
+        if (used == 0 || used != base.size() || base[0] == '-' || addr > 0xFFFFFFFF)
+            throw std::runtime_error(fmt::format("Bad base address in manifest line {}", number));
+
+        Job job;
+        job.input  = input;
+        job.output = output;
+        job.addr   = static_cast<u32>(addr);
+        job.thumb  = mode == "thumb";
+        job.order  = jobs.size();
+
+        std::error_code ec;
+        job.size = fs::file_size(job.input, ec);
+
+        jobs.push_back(std::move(job));
+    }
+    return jobs;
+}
+
+static Result run(const Job& job, const Format& format, const Compression& compression)
+{
+    constexpr std::size_t kChunkSize = 64 * 1024;
+
+    std::unique_ptr<Source> source;
+    try
+    {
+        source = makeSource(job.input, "");
+    }
+    catch (const std::exception& ex)
+    {
+        return { 1, fmt::format("Cannot read file {}: {}\n", job.input, ex.what()) };
+    }
+
+    if (!source)
+    {
+        return { 1, fmt::format("Cannot read file {}\n", job.input) };
+    }
+
+    auto sink = makeSink(job.output, compression);
+    if (!sink)
+    {
+        return { 2, fmt::format("Cannot open file {}\n", job.output) };
+    }
+
+    DisasmContext context(job.addr, job.thumb);
+    std::vector<u8> data(kChunkSize);
+    std::string text;
+    while (true)
+    {
+        std::size_t length = source->read(data.data(), data.size());
+        bool last = length < data.size();
+        if (last && source->isBad())
+        {
+            return { 1, fmt::format("Cannot read file {}\n", job.input) };
+        }
+
+        text.clear();
+        context.feed(text, format, data.data(), length);
+        if (last)
+            context.finish(text, format);
+        if (!sink->writeView(text))
+        {
+            return { 2, fmt::format("Cannot write file {}\n", job.output) };
+        }
+
+        if (last)
+            break;
+    }
+
+    if (!sink->finish())
+    {
+        return { 2, fmt::format("Cannot write file {}\n", job.output) };
+    }
+    return {};
+}
+
+int batch(const fs::path& manifest, const Format& format, const std::string& compression)
+{
+    // A bad compression fails once before any job runs
+    const auto compressor = parseCompression(compression);
+    auto jobs = parseManifest(manifest);
+
+    // Workers take the largest remaining file, so no large file starts last
+    std::stable_sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b)
+    {
+        return a.size > b.size;
+    });
+
+    // Messages are printed in manifest order once all jobs are done
+    std::vector<Result> results(jobs.size());
+    std::atomic<std::size_t> next = 0;
+    {
+        ThreadPool pool;
+        for (uint x = 0; x < pool.size(); ++x)
+        {
+            pool.submit([&]()
+            {
+                for (std::size_t index = next++; index < jobs.size(); index = next++)
+                    results[jobs[index].order] = run(jobs[index], format, compressor);
+            });
+        }
+        pool.wait();
+    }
+
+    int status = 0;
+    for (const auto& result : results)
+    {
+        fmt::print("{}", result.message);
+        status = std::max(status, result.status);
+    }
+    return status;
+}
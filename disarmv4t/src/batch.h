@@ -0,0 +1,9 @@
+#pragma once
+
+#include <string>
+
+#include <shell/filesystem.h>
+
+#include "format.h"
+
+int batch(const shell::filesystem::path& manifest, const Format& format, const std::string& compression);
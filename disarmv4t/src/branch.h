@@ -0,0 +1,54 @@
+#pragma once
+
+#include "bit.h"
+#include "int.h"
+
+constexpr u32 armBranchTarget(u32 instr, u32 pc)
+{
+    uint offset = bit::seq<0, 24>(instr);
+
+    offset = bit::signEx<24>(offset);
+    offset <<= 2;
+
+    return pc + offset;
+}
+
+constexpr u32 thumbConditionalTarget(u16 instr, u32 pc)
+{
+    uint offset = bit::seq<0, 8>(instr);
+
+    offset = bit::signEx<8>(offset);
+    offset <<= 1;
+
+    return pc + offset;
+}
+
+constexpr u32 thumbBranchTarget(u16 instr, u32 pc)
+{
+    uint offset = bit::seq<0, 11>(instr);
+
+    offset = bit::signEx<11>(offset);
+    offset <<= 1;
+
+    return pc + offset;
+}
+
+// Value of lr after the first half of a long branch
+constexpr u32 thumbLongBranchSetup(u16 instr, u32 pc)
+{
+    uint offset = bit::seq<0, 11>(instr);
+
+    offset = bit::signEx<11>(offset);
+    offset <<= 12;
+
+    return pc + offset;
+}
+
+constexpr u32 thumbLongBranchTarget(u16 instr, u32 lr)
+{
+    uint offset = bit::seq<0, 11>(instr);
+
+    offset <<= 1;
+
+    return lr + offset;
+}
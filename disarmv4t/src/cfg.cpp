@@ -0,0 +1,279 @@
+#include "cfg.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <string_view>
+
+#include <shell/fmt.h>
+
+#include "branch.h"
+#include "decode.h"
+#include "disassemble.h"
+
+Cfg::Cfg(const u8* data, std::size_t size, u32 addr, bool thumb)
+    : data(data), size(size), addr(addr), thumb(thumb)
+{
+    const uint width = thumb ? 2 : 4;
+
+    size -= size % width;
+    this->size = size;
+
+    std::vector<Branch> branches;
+
+    u32 lr = 0;
+    for (std::size_t index = 0; index < size; index += width)
+    {
+        u32 pc = addr + static_cast<u32>(index);
+
+        Branch branch = { pc, 0, Flow::None };
+        if (!thumb)
+        {
+            u32 instr;
+            std::memcpy(&instr, data + index, sizeof(instr));
+
+            bool conditional = bit::seq<28, 4>(instr) != 0xE;
+            bool returns = false;
+
+            switch (decodeArm(hashArm(instr)))
+            {
+            case InstructionArm::BranchLink:
+                branch.target = armBranchTarget(instr, pc + 8);
+                if (bit::seq<24, 1>(instr))
+                    branch.flow = Flow::Call;
+                else
+                    branch.flow = conditional ? Flow::Conditional : Flow::Jump;
+                break;
+
+            case InstructionArm::BranchExchange:
+                returns = true;
+                break;
+
+            case InstructionArm::DataProcessing:
+                returns = bit::seq<12, 4>(instr) == 15 && (bit::seq<21, 4>(instr) >> 2) != 0b10;
+                break;
+
+            case InstructionArm::SingleDataTransfer:
+            case InstructionArm::HalfSignedDataTransfer:
+                returns = bit::seq<20, 1>(instr) && bit::seq<12, 4>(instr) == 15;
+                break;
+
+            case InstructionArm::BlockDataTransfer:
+                returns = bit::seq<20, 1>(instr) && bit::seq<15, 1>(instr);
+                break;
+
+            default:
+                break;
+            }
+
+            if (returns)
+                branch.flow = conditional ? Flow::ConditionalReturn : Flow::Return;
+        }
+        else
+        {
+            u16 instr;
+            std::memcpy(&instr, data + index, sizeof(instr));
+
+            switch (decodeThumb(hashThumb(instr)))
+            {
+            case InstructionThumb::ConditionalBranch:
+                branch.target = thumbConditionalTarget(instr, pc + 4);
+                branch.flow = Flow::Conditional;
+                break;
+
+            case InstructionThumb::UnconditionalBranch:
+                branch.target = thumbBranchTarget(instr, pc + 4);
+                branch.flow = Flow::Jump;
+                break;
+
+            case InstructionThumb::LongBranchLink:
+                if (bit::seq<11, 1>(instr))
+                {
+                    branch.target = thumbLongBranchTarget(instr, lr);
+                    branch.flow = Flow::Call;
+                }
+                break;
+
+            case InstructionThumb::HighRegisterOperations:
+            {
+                uint opcode = bit::seq<8, 2>(instr);
+                uint rd     = bit::seq<0, 3>(instr) | bit::seq<7, 1>(instr) << 3;
+
+                if (opcode == 0b11 || (opcode != 0b01 && rd == 15))
+                    branch.flow = Flow::Return;
+                break;
+            }
+
+            case InstructionThumb::PushPopRegisters:
+                if (bit::seq<11, 1>(instr) && bit::seq<8, 1>(instr))
+                    branch.flow = Flow::Return;
+                break;
+
+            default:
+                break;
+            }
+
+            lr = thumbLongBranchSetup(instr, pc + 4);
+        }
+
+        if (branch.flow == Flow::None)
+            continue;
+
+        branches.push_back(branch);
+
+        if (index + width < size)
+            boundaries.push_back(pc + width);
+
+        if (branch.flow <= Flow::Call && contains(branch.target) && isAligned(branch.target))
+            boundaries.push_back(branch.target);
+    }
+
+    if (size > 0)
+        boundaries.push_back(addr);
+
+    std::sort(boundaries.begin(), boundaries.end());
+    boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
+
+    // Branches and blocks are both sorted, one merged walk finds the block ends
+    auto branch = branches.begin();
+    for (std::size_t block = 0; block < boundaries.size(); ++block)
+    {
+        u32 from = boundaries[block];
+        u32 last = blockEnd(block) - width;
+        bool next = block + 1 < boundaries.size();
+
+        while (branch != branches.end() && branch->addr < last)
+            ++branch;
+
+        Flow flow = branch != branches.end() && branch->addr == last
+            ? branch->flow
+            : Flow::None;
+
+        // Targets inside the region between instructions start no block, so
+        // their edge is dropped while the branch still ends the block
+        bool reaches = flow != Flow::None && flow <= Flow::Call && (!contains(branch->target) || isAligned(branch->target));
+
+        switch (reaches ? flow : Flow::None)
+        {
+        case Flow::Jump:
+            edges.push_back({ from, branch->target, EdgeKind::Jump });
+            break;
+
+        case Flow::Conditional:
+            edges.push_back({ from, branch->target, EdgeKind::Conditional });
+            break;
+
+        case Flow::Call:
+            edges.push_back({ from, branch->target, EdgeKind::Call });
+            break;
+
+        default:
+            break;
+        }
+
+        if (next && flow != Flow::Jump && flow != Flow::Return)
+            edges.push_back({ from, boundaries[block + 1], EdgeKind::Fallthrough });
+    }
+}
+
+std::size_t Cfg::find(u32 addr) const
+{
+    if (!contains(addr))
+        return npos;
+
+    auto iter = std::upper_bound(boundaries.begin(), boundaries.end(), addr);
+    return std::distance(boundaries.begin(), iter) - 1;
+}
+
+bool Cfg::startsBlock(u32 addr) const
+{
+    return std::binary_search(boundaries.begin(), boundaries.end(), addr);
+}
+
+bool Cfg::contains(u32 addr) const
+{
+    return addr >= this->addr && addr - this->addr < size;
+}
+
+bool Cfg::isAligned(u32 addr) const
+{
+    return (addr - this->addr) % (thumb ? 2 : 4) == 0;
+}
+
+u32 Cfg::blockEnd(std::size_t block) const
+{
+    return block + 1 < boundaries.size()
+        ? boundaries[block + 1]
+        : addr + static_cast<u32>(size);
+}
+
+static constexpr std::string_view kEdgeKinds[4] = {
+    "fall", "jump", "cond", "call"
+};
+
+void Cfg::writeDot(std::string& out) const
+{
+    out.append("digraph cfg {\n");
+    out.append("    node [shape=box fontname=\"monospace\"];\n");
+
+    char mnemonic[kMaxMnemonicSize];
+
+    u32 lr = 0;
+    for (std::size_t block = 0; block < boundaries.size(); ++block)
+    {
+        fmt::format_to(std::back_inserter(out), "    \"{:08X}\" [label=\"", boundaries[block]);
+
+        for (u32 pc = boundaries[block]; pc != blockEnd(block); pc += thumb ? 2 : 4)
+        {
+            const u8* instr = data + (pc - addr);
+
+            char* end;
+            if (thumb)
+            {
+                u16 value;
+                std::memcpy(&value, instr, sizeof(value));
+                end = disassemble(value, pc + 4, lr, mnemonic);
+                lr = thumbLongBranchSetup(value, pc + 4);
+            }
+            else
+            {
+                u32 value;
+                std::memcpy(&value, instr, sizeof(value));
+                end = disassemble(value, pc + 8, mnemonic);
+            }
+
+            fmt::format_to(std::back_inserter(out), "{:08X}  ", pc);
+            out.append(mnemonic, end);
+            out.append("\\l");
+        }
+        out.append("\"];\n");
+    }
+
+    std::vector<u32> external;
+    for (const auto& edge : edges)
+    {
+        if (!contains(edge.to))
+            external.push_back(edge.to);
+    }
+
+    std::sort(external.begin(), external.end());
+    external.erase(std::unique(external.begin(), external.end()), external.end());
+
+    for (u32 target : external)
+        fmt::format_to(std::back_inserter(out), "    \"{:08X}\" [style=dashed];\n", target);
+
+    for (const auto& edge : edges)
+    {
+        fmt::format_to(std::back_inserter(out), "    \"{:08X}\" -> \"{:08X}\"", edge.from, edge.to);
+        if (edge.kind != EdgeKind::Fallthrough)
+            fmt::format_to(std::back_inserter(out), " [label=\"{}\"]", kEdgeKinds[static_cast<uint>(edge.kind)]);
+        out.append(";\n");
+    }
+    out.append("}\n");
+}
+
+void Cfg::writeEdges(std::string& out) const
+{
+    for (const auto& edge : edges)
+        fmt::format_to(std::back_inserter(out), "{:08X} {:08X} {}\n", edge.from, edge.to, kEdgeKinds[static_cast<uint>(edge.kind)]);
+}
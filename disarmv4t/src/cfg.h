@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "int.h"
+
+// Control flow graph of a code region. Blocks are split at branch targets
+// and after control flow instructions. The data is referenced, not copied.
+class Cfg
+{
+public:
+    static constexpr std::size_t npos = -1;
+
+    enum class EdgeKind
+    {
+        Fallthrough,
+        Jump,
+        Conditional,
+        Call
+    };
+
+    struct Edge
+    {
+        u32 from;
+        u32 to;
+        EdgeKind kind;
+    };
+
+    Cfg(const u8* data, std::size_t size, u32 addr, bool thumb);
+
+    // Index of the block containing addr in O(log n), npos outside the region
+    std::size_t find(u32 addr) const;
+    bool startsBlock(u32 addr) const;
+
+    void writeDot(std::string& out) const;
+    void writeEdges(std::string& out) const;
+
+private:
+    enum class Flow
+    {
+        None,
+        Jump,
+        Conditional,
+        Call,
+        Return,
+        ConditionalReturn
+    };
+
+    struct Branch
+    {
+        u32 addr;
+        u32 target;
+        Flow flow;
+    };
+
+    bool contains(u32 addr) const;
+    bool isAligned(u32 addr) const;
+    u32 blockEnd(std::size_t block) const;
+
+    const u8* data;
+    std::size_t size;
+    u32 addr;
+    bool thumb;
+    std::vector<u32> boundaries;
+    std::vector<Edge> edges;
+};
@@ -0,0 +1,143 @@
+#include "classify.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#include "decode.h"
+
+static uint suspicious(const u8* data, std::size_t size, bool thumb)
+{
+    uint count = 0;
+    if (!thumb)
+    {
+        for (std::size_t index = 0; index + 4 <= size; index += 4)
+        {
+            u32 instr;
+            std::memcpy(&instr, data + index, sizeof(instr));
+
+            switch (decodeArm(hashArm(instr)))
+            {
+            case InstructionArm::Undefined:
+            case InstructionArm::CoprocessorDataOperations:
+            case InstructionArm::CoprocessorDataTransfers:
+            case InstructionArm::CoprocessorRegisterTransfers:
+                count++;
+                break;
+
+            default:
+                count += bit::seq<28, 4>(instr) == 0xF;
+                break;
+            }
+        }
+    }
+    else
+    {
+        // A first long branch half must be followed by a second one. Halves
+        // at the window edges may pair with the neighbouring window.
+        bool first = false;
+        for (std::size_t index = 0; index + 2 <= size; index += 2)
+        {
+            u16 instr;
+            std::memcpy(&instr, data + index, sizeof(instr));
+
+            auto kind = decodeThumb(hashThumb(instr));
+            if (kind == InstructionThumb::LongBranchLink)
+            {
+                if (bit::seq<11, 1>(instr))
+                {
+                    count += !first && index > 0;
+                    first = false;
+                }
+                else
+                {
+                    count += first;
+                    first = true;
+                }
+                continue;
+            }
+
+            count += first;
+            first = false;
+
+            switch (kind)
+            {
+            // Includes conditional branches with the al condition and high
+            // register operations without high registers
+            case InstructionThumb::Undefined:
+                count++;
+                break;
+
+            // Empty register lists are unpredictable
+            case InstructionThumb::PushPopRegisters:
+                count += bit::seq<0, 9>(instr) == 0;
+                break;
+
+            case InstructionThumb::LoadStoreMultiple:
+                count += bit::seq<0, 8>(instr) == 0;
+                break;
+
+            default:
+                break;
+            }
+        }
+    }
+    return count;
+}
+
+static double entropy(const u8* data, std::size_t size)
+{
+    std::array<uint, 256> histogram = {};
+    for (std::size_t index = 0; index < size; ++index)
+        histogram[data[index]]++;
+
+    double bits = 0;
+    for (uint count : histogram)
+    {
+        if (count == 0)
+            continue;
+
+        double p = static_cast<double>(count) / size;
+        bits -= p * std::log2(p);
+    }
+    return bits;
+}
+
+DataMap::DataMap(const u8* data, std::size_t size, u32 addr, bool thumb, uint threshold)
+    : addr(addr)
+{
+    const uint width = thumb ? 2 : 4;
+
+    windows.reserve((size + kWindowSize - 1) / kWindowSize);
+    for (std::size_t offset = 0; offset < size; offset += kWindowSize)
+    {
+        std::size_t length = std::min(kWindowSize, size - offset);
+        std::size_t count  = length / width;
+        if (count == 0)
+        {
+            windows.push_back(false);
+            continue;
+        }
+
+        double score = 100.0 * suspicious(data + offset, length, thumb) / count;
+
+        // Fills and padding have almost no entropy, code has plenty
+        double bits = entropy(data + offset, length);
+        if (bits < 2)
+            score += 50 * (2 - bits);
+
+        windows.push_back(score >= threshold);
+    }
+}
+
+bool DataMap::isData(u32 addr) const
+{
+    std::size_t window = (addr - this->addr) / kWindowSize;
+    return window < windows.size() && windows[window];
+}
+
+u32 DataMap::windowEnd(u32 addr) const
+{
+    return addr - (addr - this->addr) % kWindowSize + kWindowSize;
+}
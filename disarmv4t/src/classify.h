@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vector>
+
+#include "int.h"
+
+// Classifies fixed size windows as code or data. A window is data if its
+// share of undefined, coprocessor, never executed and unpredictable
+// instructions plus a penalty for low byte entropy reaches the threshold in
+// percent.
+class DataMap
+{
+public:
+    static constexpr std::size_t kWindowSize = 256;
+
+    DataMap(const u8* data, std::size_t size, u32 addr, bool thumb, uint threshold);
+
+    bool isData(u32 addr) const;
+    u32 windowEnd(u32 addr) const;
+
+private:
+    u32 addr;
+    std::vector<bool> windows;
+};
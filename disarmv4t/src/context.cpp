@@ -0,0 +1,108 @@
+#include "context.h"
+
+#include <algorithm>
+#include <cstring>
+
+DisasmContext::DisasmContext(u32 addr, bool thumb)
+    : addr(addr), thumb(thumb) {}
+
+void DisasmContext::feed(std::string& out, const Format& format, const u8* data, std::size_t size, const ListingHooks& hooks)
+{
+    if (tail_size > 0)
+    {
+        std::size_t take = std::min<std::size_t>(width() - tail_size, size);
+        std::memcpy(tail.data() + tail_size, data, take);
+        tail_size += static_cast<u8>(take);
+        data += take;
+        size -= take;
+
+        if (tail_size < width())
+            return;
+
+        list(out, format, tail.data(), width(), hooks);
+        tail_size = 0;
+    }
+
+    std::size_t whole = size - size % width();
+    list(out, format, data, whole, hooks);
+
+    tail_size = static_cast<u8>(size - whole);
+    std::memcpy(tail.data(), data + whole, tail_size);
+}
+
+void DisasmContext::finish(std::string& out, const Format& format, const ListingHooks& hooks)
+{
+    // An incomplete instruction is padded with zeros like a short input file
+    if (tail_size + tail_size % width() >= width())
+    {
+        std::fill(tail.begin() + tail_size, tail.end(), 0);
+        list(out, format, tail.data(), width(), hooks);
+    }
+    tail_size = 0;
+}
+
+u32 DisasmContext::address() const
+{
+    return addr;
+}
+
+bool DisasmContext::isThumb() const
+{
+    return thumb;
+}
+
+// Serialized contexts can move between hosts, so the layout is fixed:
+//   0  u32 address, little-endian
+//   4  u32 lr, little-endian
+//   8  u8  mode, 1 for Thumb
+//   9  u8  tail size
+//   10 u8  tail bytes, zero after the tail size
+static void storeLittle(u8* data, u32 value)
+{
+    for (uint x = 0; x < 4; ++x)
+        data[x] = static_cast<u8>(value >> (8 * x));
+}
+
+static u32 loadLittle(const u8* data)
+{
+    u32 value = 0;
+    for (uint x = 0; x < 4; ++x)
+        value |= u32(data[x]) << (8 * x);
+    return value;
+}
+
+DisasmContext::Serialized DisasmContext::serialize() const
+{
+    Serialized data = {};
+    storeLittle(data.data() + 0, addr);
+    storeLittle(data.data() + 4, lr);
+    data[8] = thumb;
+    data[9] = tail_size;
+    std::memcpy(data.data() + 10, tail.data(), tail_size);
+    return data;
+}
+
+bool DisasmContext::deserialize(const Serialized& data, DisasmContext& context)
+{
+    if (data[8] > 1 || data[9] >= (data[8] ? 2 : 4))
+        return false;
+
+    DisasmContext result(loadLittle(data.data() + 0), data[8]);
+    result.lr = loadLittle(data.data() + 4);
+    result.tail_size = data[9];
+    std::memcpy(result.tail.data(), data.data() + 10, result.tail_size);
+
+    context = result;
+    return true;
+}
+
+uint DisasmContext::width() const
+{
+    return thumb ? 2 : 4;
+}
+
+void DisasmContext::list(std::string& out, const Format& format, const u8* data, std::size_t size, const ListingHooks& hooks)
+{
+    listing(out, format, data, size, addr, thumb, lr, hooks);
+    addr += static_cast<u32>(size);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <string>
+
+#include "format.h"
+#include "int.h"
+#include "listing.h"
+
+// Decoder state between buffers. It holds the mode, the address of the next
+// instruction, the lr set up by a pending long branch prefix and the bytes
+// of an incomplete instruction.
+class DisasmContext
+{
+public:
+    static constexpr std::size_t kSerializedSize = 16;
+
+    using Serialized = std::array<u8, kSerializedSize>;
+
+    explicit DisasmContext(u32 addr = 0, bool thumb = false);
+
+    void feed(std::string& out, const Format& format, const u8* data, std::size_t size, const ListingHooks& hooks = {});
+    void finish(std::string& out, const Format& format, const ListingHooks& hooks = {});
+
+    u32 address() const;
+    bool isThumb() const;
+
+    // The layout is little-endian on every host, so serialized contexts can
+    // resume in other threads, processes or sessions
+    Serialized serialize() const;
+    static bool deserialize(const Serialized& data, DisasmContext& context);
+
+private:
+    uint width() const;
+    void list(std::string& out, const Format& format, const u8* data, std::size_t size, const ListingHooks& hooks);
+
+    u32 addr;
+    u32 lr = 0;
+    bool thumb;
+    u8 tail_size = 0;
+    std::array<u8, 4> tail = {};
+};
@@ -0,0 +1,241 @@
+#include "counters.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <shell/fmt.h>
+
+#include "branch.h"
+#include "decode.h"
+#include "disassemble.h"
+#include "listing.h"
+
+#ifdef __linux__
+#  include <linux/perf_event.h>
+#  include <sys/ioctl.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#endif
+
+Counters::Counters()
+{
+    fds.fill(-1);
+
+#ifdef __linux__
+    static constexpr u64 kConfigs[kEventCount] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_BRANCH_MISSES,
+        PERF_COUNT_HW_CACHE_MISSES
+    };
+
+    for (uint event = 0; event < kEventCount; ++event)
+    {
+        perf_event_attr attr = {};
+        attr.size           = sizeof(attr);
+        attr.type           = PERF_TYPE_HARDWARE;
+        attr.config         = kConfigs[event];
+        attr.disabled       = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+
+        fds[event] = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+#endif
+}
+
+Counters::~Counters()
+{
+#ifdef __linux__
+    for (int fd : fds)
+    {
+        if (fd >= 0)
+            ::close(fd);
+    }
+#endif
+}
+
+bool Counters::isAvailable(Event event) const
+{
+    return fds[event] >= 0;
+}
+
+void Counters::start()
+{
+#ifdef __linux__
+    for (int fd : fds)
+    {
+        if (fd < 0)
+            continue;
+
+        ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+    begin = Clock::now();
+}
+
+Counters::Sample Counters::stop()
+{
+    Sample sample;
+    sample.ns = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+
+#ifdef __linux__
+    for (uint event = 0; event < kEventCount; ++event)
+    {
+        int fd = fds[event];
+        if (fd < 0)
+            continue;
+
+        ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (::read(fd, &sample.values[event], sizeof(u64)) != sizeof(u64))
+            sample.values[event] = 0;
+    }
+#endif
+    return sample;
+}
+
+static constexpr const char* kArmClasses[] = {
+    "Undefined",
+    "BranchExchange",
+    "BranchLink",
+    "DataProcessing",
+    "StatusTransfer",
+    "Multiply",
+    "MultiplyLong",
+    "SingleDataTransfer",
+    "HalfSignedDataTransfer",
+    "BlockDataTransfer",
+    "SingleDataSwap",
+    "SoftwareInterrupt",
+    "CoprocessorDataOperations",
+    "CoprocessorDataTransfers",
+    "CoprocessorRegisterTransfers"
+};
+
+static constexpr const char* kThumbClasses[] = {
+    "Undefined",
+    "MoveShiftedRegister",
+    "AddSubtract",
+    "ImmediateOperations",
+    "AluOperations",
+    "HighRegisterOperations",
+    "LoadPcRelative",
+    "LoadStoreRegisterOffset",
+    "LoadStoreByteHalf",
+    "LoadStoreImmediateOffset",
+    "LoadStoreHalf",
+    "LoadStoreSpRelative",
+    "LoadRelativeAddress",
+    "AddOffsetSp",
+    "PushPopRegisters",
+    "LoadStoreMultiple",
+    "ConditionalBranch",
+    "SoftwareInterrupt",
+    "UnconditionalBranch",
+    "LongBranchLink"
+};
+
+struct Sampled
+{
+    u32 instr;
+    u32 pc;
+    u32 lr;
+};
+
+static void printRow(const Counters& counters, const char* name, u64 count, const Counters::Sample& sample)
+{
+    fmt::print("{:<30}{:>10}{:>10.2f}", name, count, sample.ns / count);
+    for (uint event = 0; event < Counters::kEventCount; ++event)
+    {
+        if (counters.isAvailable(static_cast<Counters::Event>(event)))
+            fmt::print("{:>14.3f}", static_cast<double>(sample.values[event]) / count);
+        else
+            fmt::print("{:>14}", "-");
+    }
+    fmt::print("\n");
+}
+
+void printCounters(const Format& format, const u8* data, std::size_t size, u32 addr, bool thumb)
+{
+    // Small classes are repeated to get stable numbers
+    constexpr u64 kMinSamples = 1 << 20;
+
+    const uint width = thumb ? 2 : 4;
+    const std::size_t classes = thumb ? std::size(kThumbClasses) : std::size(kArmClasses);
+
+    std::vector<std::vector<Sampled>> buckets(classes);
+    u32 lr = 0;
+    for (std::size_t offset = 0; offset + width <= size; offset += width)
+    {
+        u32 pc = addr + static_cast<u32>(offset);
+        if (thumb)
+        {
+            u16 instr;
+            std::memcpy(&instr, data + offset, sizeof(instr));
+            buckets[static_cast<uint>(decodeThumb(hashThumb(instr)))].push_back({ instr, pc + 4, lr });
+            lr = thumbLongBranchSetup(instr, pc + 4);
+        }
+        else
+        {
+            u32 instr;
+            std::memcpy(&instr, data + offset, sizeof(instr));
+            buckets[static_cast<uint>(decodeArm(hashArm(instr)))].push_back({ instr, pc + 8, 0 });
+        }
+    }
+
+    Counters counters;
+
+    bool available = false;
+    for (uint event = 0; event < Counters::kEventCount; ++event)
+        available = available || counters.isAvailable(static_cast<Counters::Event>(event));
+
+    if (!available)
+        fmt::print("Hardware counters are unavailable, only times are measured\n\n");
+
+    fmt::print("{:<30}{:>10}{:>10}{:>14}{:>14}{:>14}{:>14}\n", "class", "count", "ns", "cycles", "instructions", "branch-misses", "cache-misses");
+
+    // Every result is stored to a volatile sink, so the compiler cannot drop
+    // calls whose mnemonic is otherwise unused
+    char mnemonic[kMaxMnemonicSize];
+    volatile std::size_t escape = 0;
+    for (std::size_t index = 0; index < classes; ++index)
+    {
+        const auto& bucket = buckets[index];
+        if (bucket.empty())
+            continue;
+
+        u64 rounds = std::max<u64>(1, kMinSamples / bucket.size());
+
+        counters.start();
+        for (u64 round = 0; round < rounds; ++round)
+        {
+            for (const auto& sampled : bucket)
+            {
+                char* end = thumb
+                    ? disassemble(static_cast<u16>(sampled.instr), sampled.pc, sampled.lr, mnemonic)
+                    : disassemble(sampled.instr, sampled.pc, mnemonic);
+
+                escape = static_cast<std::size_t>(end - mnemonic) + static_cast<u8>(mnemonic[0]);
+            }
+        }
+        auto sample = counters.stop();
+
+        printRow(counters, thumb ? kThumbClasses[index] : kArmClasses[index], rounds * bucket.size(), sample);
+    }
+    static_cast<void>(escape);
+
+    std::string text;
+    text.reserve(size / width * 64);
+
+    lr = 0;
+    counters.start();
+    listing(text, format, data, size, addr, thumb, lr);
+    auto sample = counters.stop();
+
+    fmt::print("\n");
+    printRow(counters, "listing", std::max<u64>(1, size / width), sample);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+
+#include "format.h"
+#include "int.h"
+
+// Hardware counters of the calling thread via perf_event_open. Events the
+// kernel or hardware does not provide stay unavailable and only the time is
+// measured for them.
+class Counters
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum Event
+    {
+        kEventCycles,
+        kEventInstructions,
+        kEventBranchMisses,
+        kEventCacheMisses,
+        kEventCount
+    };
+
+    struct Sample
+    {
+        double ns = 0;
+        std::array<u64, kEventCount> values = {};
+    };
+
+    Counters();
+    ~Counters();
+
+    bool isAvailable(Event event) const;
+
+    void start();
+    Sample stop();
+
+private:
+    std::array<int, kEventCount> fds;
+    Clock::time_point begin;
+};
+
+// Measures disassembly per instruction class and for the whole listing
+void printCounters(const Format& format, const u8* data, std::size_t size, u32 addr, bool thumb);
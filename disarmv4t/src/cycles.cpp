@@ -0,0 +1,385 @@
+#include "cycles.h"
+
+#include <algorithm>
+#include <charconv>
+#include <iterator>
+
+#include <shell/constants.h>
+#include <shell/fmt.h>
+
+#include "decode.h"
+
+bool Waitstates::parse(const std::string& region, Waitstates& waitstates)
+{
+    if (region == "iwram")
+    {
+        waitstates = { 1, 1, 1, 1 };
+        return true;
+    }
+    if (region == "ewram")
+    {
+        waitstates = { 3, 3, 6, 6 };
+        return true;
+    }
+
+    uint n = 4;
+    uint s = 2;
+    if (region != "rom")
+    {
+        const char* begin = region.data();
+        const char* end   = region.data() + region.size();
+
+        auto [sep, ec1] = std::from_chars(begin, end, n);
+        if (ec1 != std::errc() || sep == end || *sep != ',')
+            return false;
+
+        auto [last, ec2] = std::from_chars(sep + 1, end, s);
+        if (ec2 != std::errc() || last != end)
+            return false;
+    }
+
+    // The cartridge bus is 16-bit wide and splits 32-bit accesses
+    waitstates.n16 = 1 + n;
+    waitstates.s16 = 1 + s;
+    waitstates.n32 = waitstates.n16 + waitstates.s16;
+    waitstates.s32 = 2 * waitstates.s16;
+    return true;
+}
+
+uint Cycles::min(uint n_cycles, uint s_cycles) const
+{
+    if (conditional)
+        return s_cycles;
+
+    return s * s_cycles + n * n_cycles + i;
+}
+
+uint Cycles::max(uint n_cycles, uint s_cycles) const
+{
+    return s * s_cycles + n * n_cycles + std::max(i, iMax);
+}
+
+static Cycles load(uint registers, bool pc)
+{
+    Cycles cycles;
+    cycles.s = registers;
+    cycles.n = 1;
+    cycles.i = 1;
+
+    if (pc)
+    {
+        cycles.s++;
+        cycles.n++;
+        cycles.branch = true;
+    }
+    return cycles;
+}
+
+static Cycles store(uint registers)
+{
+    Cycles cycles;
+    cycles.s = registers - 1;
+    cycles.n = 2;
+    return cycles;
+}
+
+static Cycles branch()
+{
+    Cycles cycles;
+    cycles.s = 2;
+    cycles.n = 1;
+    cycles.branch = true;
+    return cycles;
+}
+
+// Undefined instructions, and coprocessor instructions without a coprocessor
+// to accept them, take the undefined instruction trap
+static Cycles trap()
+{
+    Cycles cycles;
+    cycles.s = 2;
+    cycles.n = 1;
+    cycles.i = 1;
+    cycles.branch = true;
+    return cycles;
+}
+
+static Cycles multiply(uint i)
+{
+    // Early termination depends on the value of the multiplier
+    Cycles cycles;
+    cycles.s = 1;
+    cycles.i = i;
+    cycles.iMax = i + 3;
+    return cycles;
+}
+
+Cycles cycles(u32 instr)
+{
+    Cycles cycles;
+    cycles.s = 1;
+
+    switch (decodeArm(hashArm(instr)))
+    {
+    case InstructionArm::BranchExchange:
+    case InstructionArm::BranchLink:
+        cycles = branch();
+        break;
+
+    case InstructionArm::DataProcessing:
+    {
+        uint imm_op = bit::seq<25, 1>(instr);
+        uint opcode = bit::seq<21, 4>(instr);
+        uint rd     = bit::seq<12, 4>(instr);
+
+        if (!imm_op && bit::seq<4, 1>(instr))
+            cycles.i = 1;
+
+        if (rd == 15 && (opcode >> 2) != 0b10)
+        {
+            cycles.s++;
+            cycles.n++;
+            cycles.branch = true;
+        }
+        break;
+    }
+
+    case InstructionArm::StatusTransfer:
+        break;
+
+    case InstructionArm::Multiply:
+        cycles = multiply(bit::seq<21, 1>(instr) ? 2 : 1);
+        break;
+
+    case InstructionArm::MultiplyLong:
+        cycles = multiply(bit::seq<21, 1>(instr) ? 3 : 2);
+        break;
+
+    case InstructionArm::SingleDataTransfer:
+    case InstructionArm::HalfSignedDataTransfer:
+        if (bit::seq<20, 1>(instr))
+            cycles = load(1, bit::seq<12, 4>(instr) == 15);
+        else
+            cycles = store(1);
+        break;
+
+    case InstructionArm::BlockDataTransfer:
+    {
+        uint rlist = bit::seq<0, 16>(instr);
+        uint count = std::max<uint>(bit::popcnt(rlist), 1);
+
+        if (bit::seq<20, 1>(instr))
+            cycles = load(count, rlist & (1 << 15));
+        else
+            cycles = store(count);
+        break;
+    }
+
+    case InstructionArm::SingleDataSwap:
+        cycles.n = 2;
+        cycles.i = 1;
+        break;
+
+    case InstructionArm::SoftwareInterrupt:
+        cycles = branch();
+        break;
+
+    case InstructionArm::Undefined:
+    case InstructionArm::CoprocessorDataOperations:
+    case InstructionArm::CoprocessorDataTransfers:
+    case InstructionArm::CoprocessorRegisterTransfers:
+        cycles = trap();
+        break;
+    }
+
+    cycles.conditional = bit::seq<28, 4>(instr) != 0xE;
+    return cycles;
+}
+
+Cycles cycles(u16 instr)
+{
+    Cycles cycles;
+    cycles.s = 1;
+
+    switch (decodeThumb(hashThumb(instr)))
+    {
+    case InstructionThumb::MoveShiftedRegister:
+    case InstructionThumb::AddSubtract:
+    case InstructionThumb::ImmediateOperations:
+    case InstructionThumb::LoadRelativeAddress:
+    case InstructionThumb::AddOffsetSp:
+        break;
+
+    case InstructionThumb::AluOperations:
+    {
+        enum Opcode
+        {
+            kOpcodeLsl = 2,
+            kOpcodeLsr = 3,
+            kOpcodeAsr = 4,
+            kOpcodeRor = 7,
+            kOpcodeMul = 13
+        };
+
+        uint opcode = bit::seq<6, 4>(instr);
+
+        if (opcode == kOpcodeMul)
+            cycles = multiply(1);
+        else if (opcode == kOpcodeLsl || opcode == kOpcodeLsr || opcode == kOpcodeAsr || opcode == kOpcodeRor)
+            cycles.i = 1;
+        break;
+    }
+
+    case InstructionThumb::HighRegisterOperations:
+    {
+        enum Opcode
+        {
+            kOpcodeAdd,
+            kOpcodeCmp,
+            kOpcodeMov,
+            kOpcodeBx
+        };
+
+        uint opcode = bit::seq<8, 2>(instr);
+        uint rd     = bit::seq<0, 3>(instr) | bit::seq<7, 1>(instr) << 3;
+
+        if (opcode == kOpcodeBx || (opcode != kOpcodeCmp && rd == 15))
+            cycles = branch();
+        break;
+    }
+
+    case InstructionThumb::LoadPcRelative:
+        cycles = load(1, false);
+        break;
+
+    case InstructionThumb::LoadStoreRegisterOffset:
+        cycles = bit::seq<11, 1>(instr) ? load(1, false) : store(1);
+        break;
+
+    case InstructionThumb::LoadStoreByteHalf:
+        cycles = bit::seq<10, 2>(instr) != 0 ? load(1, false) : store(1);
+        break;
+
+    case InstructionThumb::LoadStoreImmediateOffset:
+        cycles = bit::seq<11, 1>(instr) ? load(1, false) : store(1);
+        break;
+
+    case InstructionThumb::LoadStoreHalf:
+    case InstructionThumb::LoadStoreSpRelative:
+        cycles = bit::seq<11, 1>(instr) ? load(1, false) : store(1);
+        break;
+
+    case InstructionThumb::PushPopRegisters:
+    {
+        uint rbit  = bit::seq<8, 1>(instr);
+        uint count = bit::popcnt(bit::seq<0, 8>(instr)) + rbit;
+
+        count = std::max<uint>(count, 1);
+
+        if (bit::seq<11, 1>(instr))
+            cycles = load(count, rbit);
+        else
+            cycles = store(count);
+        break;
+    }
+
+    case InstructionThumb::LoadStoreMultiple:
+    {
+        uint count = std::max<uint>(bit::popcnt(bit::seq<0, 8>(instr)), 1);
+
+        cycles = bit::seq<11, 1>(instr) ? load(count, false) : store(count);
+        break;
+    }
+
+    case InstructionThumb::ConditionalBranch:
+        cycles = branch();
+        cycles.conditional = true;
+        break;
+
+    case InstructionThumb::LongBranchLink:
+        if (bit::seq<11, 1>(instr))
+            cycles = branch();
+        break;
+
+    case InstructionThumb::SoftwareInterrupt:
+    case InstructionThumb::UnconditionalBranch:
+        cycles = branch();
+        break;
+
+    case InstructionThumb::Undefined:
+        cycles = trap();
+        break;
+    }
+    return cycles;
+}
+
+CycleCounter::CycleCounter(const Waitstates& waitstates, const Cfg* cfg)
+    : waitstates(waitstates), cfg(cfg) {}
+
+static void putRange(std::string& out, uint min, uint max)
+{
+    if (min == max)
+        fmt::format_to(std::back_inserter(out), "{}", min);
+    else
+        fmt::format_to(std::back_inserter(out), "{}-{}", min, max);
+}
+
+void CycleCounter::split(std::string& out, u32 addr)
+{
+    if (count > 0 && cfg && cfg->startsBlock(addr))
+        finish(out);
+}
+
+void CycleCounter::annotate(std::string& out, std::size_t line, u32 addr, u32 instr, bool thumb)
+{
+    Cycles cost = thumb
+        ? cycles(static_cast<u16>(instr))
+        : cycles(instr);
+
+    uint n_cycles = thumb ? waitstates.n16 : waitstates.n32;
+    uint s_cycles = thumb ? waitstates.s16 : waitstates.s32;
+
+    uint lo = cost.min(n_cycles, s_cycles);
+    uint hi = cost.max(n_cycles, s_cycles);
+
+    if (count == 0)
+        begin = addr;
+    end = addr;
+    count++;
+    min += lo;
+    max += hi;
+
+    std::size_t length = out.size() - line;
+    out.append(length < kColumn ? kColumn - length : 1, ' ');
+    out.append("; ");
+    if (cost.s) fmt::format_to(std::back_inserter(out), "{}S+", cost.s);
+    if (cost.n) fmt::format_to(std::back_inserter(out), "{}N+", cost.n);
+    if (cost.i || cost.iMax)
+    {
+        putRange(out, cost.i, std::max(cost.i, cost.iMax));
+        out.append("I+");
+    }
+    out.back() = ' ';
+    out.append("= ");
+    putRange(out, lo, hi);
+    out.append(shell::kLineBreak);
+
+    if (cost.branch)
+        finish(out);
+}
+
+void CycleCounter::finish(std::string& out)
+{
+    if (count == 0)
+        return;
+
+    fmt::format_to(std::back_inserter(out), "; block {:08X}-{:08X}: {} instruction{}, ", begin, end, count, count == 1 ? "" : "s");
+    putRange(out, min, max);
+    out.append(" cycles");
+    out.append(shell::kLineBreak);
+    out.append(shell::kLineBreak);
+
+    count = 0;
+    min = 0;
+    max = 0;
+}
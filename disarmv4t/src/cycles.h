@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+
+#include "cfg.h"
+#include "int.h"
+
+// Access cycles of a memory region for 16 and 32-bit accesses
+struct Waitstates
+{
+    uint n16 = 1;
+    uint s16 = 1;
+    uint n32 = 1;
+    uint s32 = 1;
+
+    // Parses "iwram", "ewram", "rom" or "<n>,<s>" cartridge waitstates
+    static bool parse(const std::string& region, Waitstates& waitstates);
+};
+
+// ARM7TDMI cost in sequential, non-sequential and internal cycles
+struct Cycles
+{
+    uint s = 0;
+    uint n = 0;
+    uint i = 0;
+    uint iMax = 0;
+    bool conditional = false;
+    bool branch = false;
+
+    uint min(uint n_cycles, uint s_cycles) const;
+    uint max(uint n_cycles, uint s_cycles) const;
+};
+
+Cycles cycles(u32 instr);
+Cycles cycles(u16 instr);
+
+// Annotates listing lines with cycle costs and ends basic blocks with their
+// totals. Blocks end after control flow instructions and, if a control flow
+// graph of the input is given, before branch targets.
+class CycleCounter
+{
+public:
+    explicit CycleCounter(const Waitstates& waitstates, const Cfg* cfg = nullptr);
+
+    void split(std::string& out, u32 addr);
+    void annotate(std::string& out, std::size_t line, u32 addr, u32 instr, bool thumb);
+    void finish(std::string& out);
+
+private:
+    static constexpr std::size_t kColumn = 52;
+
+    Waitstates waitstates;
+    const Cfg* cfg;
+    u32 begin = 0;
+    u32 end = 0;
+    uint count = 0;
+    uint min = 0;
+    uint max = 0;
+};
@@ -1,14 +1,14 @@
 #include "disassemble.h"
 
 #include <array>
+#include <string_view>
+#include <utility>
 
-#include <shell/fmt.h>
-
+#include "branch.h"
 #include "decode.h"
+#include "emitter.h"
 
-#define MNEMONIC "{:<10}"
-
-static constexpr std::array<const char*, 43> kBiosFunctions =
+static constexpr std::array<std::string_view, 43> kBiosFunctions =
 {
     "SoftReset",
     "RegisterRamReset",
@@ -55,54 +55,31 @@ static constexpr std::array<const char*, 43> kBiosFunctions =
     "SoundGetJumpList"
 };
 
-const char* reg(uint n)
-{
-    static constexpr const char* kRegs[16] = {
-         "r0", "r1",  "r2",  "r3",
-         "r4", "r5",  "r6",  "r7",
-         "r8", "r9", "r10", "r11",
-        "r12", "sp",  "lr",  "pc"
-    };
-    return kRegs[n];
-}
-
-const char* condition(u32 instr)
-{
-    static constexpr const char* kConditions[16] = {
-        "eq", "ne", "cs", "cc",
-        "mi", "pl", "vs", "vc",
-        "hi", "ls", "ge", "lt",
-        "gt", "le",   "", "nv"
-    };
-    return kConditions[instr >> 28];
-}
-
-std::string hex(u32 value)
-{
-    return fmt::format(FMT_COMPILE("0x{:X}"), value);
-}
-
-std::string rlist(u16 rlist)
+void rlist(Emitter& out, u16 rlist)
 {
     if (rlist == 0)
-        return "{}";
+    {
+        out.put("{}");
+        return;
+    }
 
-    fmt::memory_buffer buffer;
-    buffer.push_back('{');
+    out.put('{');
 
+    bool first = true;
     for (uint x : bit::iterate(rlist))
     {
-        fmt::format_to(
-            std::back_inserter(buffer),
-            FMT_COMPILE("{},"),
-            reg(x));
+        if (!first)
+            out.put(',');
+
+        out.putReg(x);
+        first = false;
     }
 
-    *(buffer.end() - 1) = '}';
-    return std::string(buffer.begin(), buffer.end());
+    out.put('}');
 }
 
-std::string shiftedRegister(uint data)
+template<u32 Instr>
+void shiftedRegister(Emitter& out, uint data)
 {
     enum Shift
     {
@@ -112,54 +89,49 @@ std::string shiftedRegister(uint data)
         kShiftRor = 0b11,
     };
 
-    static constexpr const char* kMnemonics[4] = {
+    static constexpr std::string_view kMnemonics[4] = {
         "lsl", "lsr", "asr", "ror"
     };
 
-    uint rm     = bit::seq<0, 4>(data);
-    uint reg_op = bit::seq<4, 1>(data);
-    uint shift  = bit::seq<5, 2>(data);
+    constexpr uint reg_op = bit::seq<4, 1>(Instr);
+    constexpr uint shift  = bit::seq<5, 2>(Instr);
+
+    uint rm = bit::seq<0, 4>(data);
 
-    std::string offset;
-    if (reg_op)
+    if constexpr (reg_op)
     {
         uint rs = bit::seq<8, 4>(data);
-        offset = reg(rs);
+
+        out.putReg(rm);
+        out.put(',');
+        out.put(kMnemonics[shift]);
+        out.put(' ');
+        out.putReg(rs);
     }
     else
     {
         uint amount = bit::seq<7, 5>(data);
         if (!amount)
         {
-            switch (shift)
-            {
-                case kShiftLsr:
-                case kShiftAsr:
-                    amount = 32;
-                    break;
-            }
+            if constexpr (shift == kShiftLsr || shift == kShiftAsr)
+                amount = 32;
         }
 
+        out.putReg(rm);
+
         if (!amount)
         {
-            std::string value = reg(rm);
-            switch (shift)
-            {
-                case kShiftRor:
-                    value.append(",rrx");
-                    break;
-            }
-            return value;
+            if constexpr (shift == kShiftRor)
+                out.put(",rrx");
+
+            return;
         }
 
-        offset = hex(amount);
+        out.put(',');
+        out.put(kMnemonics[shift]);
+        out.put(' ');
+        out.putHex(amount);
     }
-
-    return fmt::format(
-        FMT_COMPILE("{},{} {}"),
-        reg(rm),
-        kMnemonics[shift],
-        offset);
 }
 
 u32 rotatedImmediate(uint data)
@@ -170,40 +142,35 @@ u32 rotatedImmediate(uint data)
     return bit::ror(value, amount << 1);
 }
 
-std::string Arm_BranchExchange(u32 instr)
+std::string_view biosFunction(uint comment)
 {
-    uint rn = bit::seq<0, 4>(instr);
-
-    const auto mnemonic = fmt::format(
-        FMT_COMPILE("bx{}"),
-        condition(instr));
-
-    return fmt::format(
-        FMT_COMPILE(MNEMONIC"{}"),
-        mnemonic,
-        reg(rn));
+    return comment < kBiosFunctions.size()
+        ? kBiosFunctions[comment]
+        : "Unknown";
 }
 
-std::string Arm_BranchLink(u32 instr, u32 pc)
+template<u32 Instr>
+void Arm_BranchExchange(Emitter& out, u32 instr, u32)
 {
-    uint offset = bit::seq< 0, 24>(instr);
-    uint link   = bit::seq<24,  1>(instr);
+    uint rn = bit::seq<0, 4>(instr);
 
-    offset = bit::signEx<24>(offset);
-    offset <<= 2;
+    out.put("bx");
+    out.putCond(instr);
+    out.putReg(rn);
+}
 
-    const auto mnemonic = fmt::format(
-        FMT_COMPILE("{}{}"),
-        link ? "bl" : "b",
-        condition(instr));
+template<u32 Instr>
+void Arm_BranchLink(Emitter& out, u32 instr, u32 pc)
+{
+    constexpr uint link = bit::seq<24, 1>(Instr);
 
-    return fmt::format(
-        FMT_COMPILE(MNEMONIC"{}"),
-        mnemonic,
-        hex(pc + offset));
+    out.put(link ? "bl" : "b");
+    out.putCond(instr);
+    out.putHex(armBranchTarget(instr, pc));
 }
 
-std::string Arm_DataProcessing(u32 instr, u32 pc)
+template<u32 Instr>
+void Arm_DataProcessing(Emitter& out, u32 instr, u32 pc)
 {
     enum Opcode
     {
@@ -225,91 +192,71 @@ std::string Arm_DataProcessing(u32 instr, u32 pc)
         kOpcodeMvn
     };
 
-    static constexpr const char* kMnemonics[16] = {
+    static constexpr std::string_view kMnemonics[16] = {
         "and", "eor", "sub", "rsb",
         "add", "adc", "sbc", "rsc",
         "tst", "teq", "cmp", "cmn",
         "orr", "mov", "bic", "mvn"
     };
 
-    uint rd     = bit::seq<12, 4>(instr);
-    uint rn     = bit::seq<16, 4>(instr);
-    uint flags  = bit::seq<20, 1>(instr);
-    uint opcode = bit::seq<21, 4>(instr);
-    uint imm_op = bit::seq<25, 1>(instr);
+    constexpr uint flags  = bit::seq<20, 1>(Instr);
+    constexpr uint opcode = bit::seq<21, 4>(Instr);
+    constexpr uint imm_op = bit::seq<25, 1>(Instr);
+
+    uint rd = bit::seq<12, 4>(instr);
+    uint rn = bit::seq<16, 4>(instr);
+
+    out.put(kMnemonics[opcode]);
+    out.put(flags && (opcode >> 2) != 0b10 ? "s" : "");
+    out.putCond(instr);
 
-    std::string operand;
-    if (imm_op)
+    if constexpr (imm_op && (opcode == kOpcodeAdd || opcode == kOpcodeSub))
     {
-        u32 value = rotatedImmediate(instr);
         if (rn == 15)
         {
-            if (opcode == kOpcodeSub) value = pc - value;
-            if (opcode == kOpcodeAdd) value = pc + value;
+            u32 value = rotatedImmediate(instr);
+            if constexpr (opcode == kOpcodeSub) value = pc - value;
+            if constexpr (opcode == kOpcodeAdd) value = pc + value;
+
+            out.putReg(rd);
+            out.put(",=");
+            out.putHex(value);
+            return;
         }
-        operand = hex(value);
     }
-    else
-    {
-        operand = shiftedRegister(instr);
-    }
-
-    const auto mnemonic = fmt::format(
-        FMT_COMPILE("{}{}{}"),
-        kMnemonics[opcode],
-        flags && (opcode >> 2) != 0b10 ? "s" : "",
-        condition(instr));
 
     switch (opcode)
     {
-    case kOpcodeAdd:
-    case kOpcodeSub:
-        if (rn == 15 && imm_op)
-        {
-            return fmt::format(
-                FMT_COMPILE(MNEMONIC"{},={}"),
-                mnemonic,
-                reg(rd),
-                operand);
-        }
-        else
-        {
-            return fmt::format(
-                FMT_COMPILE(MNEMONIC"{},{},{}"),
-                mnemonic,
-                reg(rd),
-                reg(rn),
-                operand);
-        }
-
     case kOpcodeTst:
     case kOpcodeTeq:
     case kOpcodeCmp:
     case kOpcodeCmn:
-        return fmt::format(
-            FMT_COMPILE(MNEMONIC"{},{}"),
-            mnemonic,
-            reg(rn),
-            operand);
+        out.putReg(rn);
+        out.put(',');
+        break;
 
     case kOpcodeMov:
     case kOpcodeMvn:
-        return fmt::format(
-            FMT_COMPILE(MNEMONIC"{},{}"),
-            mnemonic,
-            reg(rd),
-            operand);
+        out.putReg(rd);
+        out.put(',');
+        break;
+
+    default:
+        out.putReg(rd);
+        out.put(',');
+        out.putReg(rn);
+        out.put(',');
+        break;
     }
 
-    return fmt::format(
-        FMT_COMPILE(MNEMONIC"{},{},{}"),
-        mnemonic,
-        reg(rd),
-        reg(rn),
-        operand);
+    if constexpr (imm_op)
+        out.putHex(rotatedImmediate(instr));
+    else
+        shiftedRegister<Instr>(out, instr);
 }
 
-std::string Arm_StatusTransfer(u32 instr)
+template<u32 Instr>
+void Arm_StatusTransfer(Emitter& out, u32 instr, u32)
 {
     enum Bit
     {
@@ -319,377 +266,345 @@ std::string Arm_StatusTransfer(u32 instr)
         kBitF = 1 << 19
     };
 
-    uint write = bit::seq<21, 1>(instr);
-    uint spsr  = bit::seq<22, 1>(instr);
+    constexpr uint write = bit::seq<21, 1>(Instr);
+    constexpr uint spsr  = bit::seq<22, 1>(Instr);
 
-    const char* psr = spsr
+    constexpr std::string_view psr = spsr
         ? "spsr"
         : "cpsr";
 
-    if (write)
+    if constexpr (write)
     {
-        uint imm_op = bit::seq<25, 1>(instr);
+        constexpr uint imm_op = bit::seq<25, 1>(Instr);
 
-        std::string operand;
-        if (imm_op)
-        {
-            operand = hex(rotatedImmediate(instr));
-        }
-        else
-        {
-            uint rm = bit::seq<0, 4>(instr);
-            operand = reg(rm);
-        }
+        out.put("msr");
+        out.putCond(instr);
+        out.put(psr);
 
-        std::string fsxc;
         if (instr & (kBitF | kBitS | kBitX | kBitC))
         {
-            fsxc.append("_");
+            out.put('_');
 
-            if (instr & kBitF) fsxc.append("f");
-            if (instr & kBitS) fsxc.append("s");
-            if (instr & kBitX) fsxc.append("x");
-            if (instr & kBitC) fsxc.append("c");
+            if (instr & kBitF) out.put('f');
+            if (instr & kBitS) out.put('s');
+            if (instr & kBitX) out.put('x');
+            if (instr & kBitC) out.put('c');
         }
 
-        const auto mnemonic = fmt::format(
-            FMT_COMPILE("msr{}"),
-            condition(instr));
+        out.put(',');
 
-        return fmt::format(
-            FMT_COMPILE(MNEMONIC"{}{},{}"),
-            mnemonic,
-            psr,
-            fsxc,
-            operand);
+        if constexpr (imm_op)
+        {
+            out.putHex(rotatedImmediate(instr));
+        }
+        else
+        {
+            uint rm = bit::seq<0, 4>(instr);
+            out.putReg(rm);
+        }
     }
     else
     {
         uint rd = bit::seq<12, 4>(instr);
 
-        const auto mnemonic = fmt::format(
-            FMT_COMPILE("mrs{}"),
-            condition(instr));
-
-        return fmt::format(
-            FMT_COMPILE(MNEMONIC"{},{}"),
-            mnemonic,
-            reg(rd),
-            psr);
+        out.put("mrs");
+        out.putCond(instr);
+        out.putReg(rd);
+        out.put(',');
+        out.put(psr);
     }
 }
 
-std::string Arm_Multiply(u32 instr)
+template<u32 Instr>
+void Arm_Multiply(Emitter& out, u32 instr, u32)
 {
-    uint rm         = bit::seq< 0, 4>(instr);
-    uint rs         = bit::seq< 8, 4>(instr);
-    uint rn         = bit::seq<12, 4>(instr);
-    uint rd         = bit::seq<16, 4>(instr);
-    uint flags      = bit::seq<20, 1>(instr);
-    uint accumulate = bit::seq<21, 1>(instr);
+    constexpr uint flags      = bit::seq<20, 1>(Instr);
+    constexpr uint accumulate = bit::seq<21, 1>(Instr);
 
-    const auto mnemonic = fmt::format(
-        FMT_COMPILE("{}{}{}"),
-        accumulate ? "mla" : "mul",
-        flags ? "s" : "",
-        condition(instr));
+    uint rm = bit::seq< 0, 4>(instr);
+    uint rs = bit::seq< 8, 4>(instr);
+    uint rn = bit::seq<12, 4>(instr);
+    uint rd = bit::seq<16, 4>(instr);
 
-    if (accumulate)
-    {
-        return fmt::format(
-            FMT_COMPILE(MNEMONIC"{},{},{},{}"),
-            mnemonic,
-            reg(rd),
-            reg(rm),
-            reg(rs),
-            reg(rn));
-    }
-    else
+    out.put(accumulate ? "mla" : "mul");
+    out.put(flags ? "s" : "");
+    out.putCond(instr);
+
+    out.putReg(rd);
+    out.put(',');
+    out.putReg(rm);
+    out.put(',');
+    out.putReg(rs);
+
+    if constexpr (accumulate)
     {
-        return fmt::format(
-            FMT_COMPILE(MNEMONIC"{},{},{}"),
-            mnemonic,
-            reg(rd),
-            reg(rm),
-            reg(rs));
+        out.put(',');
+        out.putReg(rn);
     }
 }
 
-std::string Arm_MultiplyLong(u32 instr)
+template<u32 Instr>
+void Arm_MultiplyLong(Emitter& out, u32 instr, u32)
 {
-    static constexpr const char* kMnemonics[4] = {
+    static constexpr std::string_view kMnemonics[4] = {
         "umull", "umlal", "smull", "smlal"
     };
 
-    uint rm     = bit::seq< 0, 4>(instr);
-    uint rs     = bit::seq< 8, 4>(instr);
-    uint rdl    = bit::seq<12, 4>(instr);
-    uint rdh    = bit::seq<16, 4>(instr);
-    uint flags  = bit::seq<20, 1>(instr);
-    uint opcode = bit::seq<21, 2>(instr);
-
-    const auto mnemonic = fmt::format(
-        FMT_COMPILE("{}{}{}"), 
-        kMnemonics[opcode],
-        flags ? "s" : "",
-        condition(instr));
-
-    return fmt::format(
-        FMT_COMPILE(MNEMONIC"{},{},{},{}"),
-        mnemonic,
-        reg(rdl),
-        reg(rdh),
-        reg(rm),
-        reg(rs));
-}
-
-std::string Arm_SingleDataTransfer(u32 instr)
-{
-    uint data      = bit::seq< 0, 12>(instr);
-    uint rd        = bit::seq<12,  4>(instr);
-    uint rn        = bit::seq<16,  4>(instr);
-    uint load      = bit::seq<20,  1>(instr);
-    uint writeback = bit::seq<21,  1>(instr);
-    uint byte      = bit::seq<22,  1>(instr);
-    uint increment = bit::seq<23,  1>(instr);
-    uint pre_index = bit::seq<24,  1>(instr);
-    uint imm_op    = bit::seq<25,  1>(instr);
-
-    const auto offset = imm_op
-        ? shiftedRegister(data)
-        : hex(data);
-
-    const auto mnemonic = fmt::format(
-        FMT_COMPILE("{}{}{}"),
-        load ? "ldr" : "str",
-        byte ? "b" : "",
-        condition(instr));
-
-    if (pre_index)
-    {
-        return fmt::format(
-            FMT_COMPILE(MNEMONIC"{},[{},{}{}]{}"),
-            mnemonic,
-            reg(rd),
-            reg(rn),
-            increment ? "" : "-",
-            offset,
-            writeback ? "!" : "");
-    }
+    constexpr uint flags  = bit::seq<20, 1>(Instr);
+    constexpr uint opcode = bit::seq<21, 2>(Instr);
+
+    uint rm  = bit::seq< 0, 4>(instr);
+    uint rs  = bit::seq< 8, 4>(instr);
+    uint rdl = bit::seq<12, 4>(instr);
+    uint rdh = bit::seq<16, 4>(instr);
+
+    out.put(kMnemonics[opcode]);
+    out.put(flags ? "s" : "");
+    out.putCond(instr);
+
+    out.putReg(rdl);
+    out.put(',');
+    out.putReg(rdh);
+    out.put(',');
+    out.putReg(rm);
+    out.put(',');
+    out.putReg(rs);
+}
+
+template<u32 Instr>
+void Arm_SingleDataTransfer(Emitter& out, u32 instr, u32)
+{
+    constexpr uint load      = bit::seq<20, 1>(Instr);
+    constexpr uint writeback = bit::seq<21, 1>(Instr);
+    constexpr uint byte      = bit::seq<22, 1>(Instr);
+    constexpr uint increment = bit::seq<23, 1>(Instr);
+    constexpr uint pre_index = bit::seq<24, 1>(Instr);
+    constexpr uint imm_op    = bit::seq<25, 1>(Instr);
+
+    uint data = bit::seq< 0, 12>(instr);
+    uint rd   = bit::seq<12,  4>(instr);
+    uint rn   = bit::seq<16,  4>(instr);
+
+    out.put(load ? "ldr" : "str");
+    out.put(byte ? "b" : "");
+    out.putCond(instr);
+
+    out.putReg(rd);
+    out.put(",[");
+    out.putReg(rn);
+
+    if constexpr (pre_index)
+        out.put(',');
     else
-    {
-        return fmt::format(
-            FMT_COMPILE(MNEMONIC"{},[{}],{}{}"),
-            mnemonic,
-            reg(rd),
-            reg(rn),
-            increment ? "" : "-",
-            offset);
-    }
+        out.put("],");
+
+    if constexpr (!increment)
+        out.put('-');
+
+    if constexpr (imm_op)
+        shiftedRegister<Instr>(out, data);
+    else
+        out.putHex(data);
+
+    if constexpr (pre_index)
+        out.put(writeback ? "]!" : "]");
 }
 
-std::string Arm_HalfSignedDataTransfer(u32 instr)
+template<u32 Instr>
+void Arm_HalfSignedDataTransfer(Emitter& out, u32 instr, u32)
 {
-    uint half      = bit::seq< 5, 1>(instr);
-    uint sign      = bit::seq< 6, 1>(instr);
-    uint rd        = bit::seq<12, 4>(instr);
-    uint rn        = bit::seq<16, 4>(instr);
-    uint load      = bit::seq<20, 1>(instr);
-    uint writeback = bit::seq<21, 1>(instr);
-    uint imm_op    = bit::seq<22, 1>(instr);
-    uint increment = bit::seq<23, 1>(instr);
-    uint pre_index = bit::seq<24, 1>(instr);
+    constexpr uint half      = bit::seq< 5, 1>(Instr);
+    constexpr uint sign      = bit::seq< 6, 1>(Instr);
+    constexpr uint load      = bit::seq<20, 1>(Instr);
+    constexpr uint writeback = bit::seq<21, 1>(Instr);
+    constexpr uint imm_op    = bit::seq<22, 1>(Instr);
+    constexpr uint increment = bit::seq<23, 1>(Instr);
+    constexpr uint pre_index = bit::seq<24, 1>(Instr);
+
+    uint rd = bit::seq<12, 4>(instr);
+    uint rn = bit::seq<16, 4>(instr);
 
-    std::string offset;
-    if (imm_op)
+    out.put(load ? "ldr" : "str");
+    out.put(sign ? "s" : "");
+    out.put(half ? "h" : "b");
+    out.putCond(instr);
+
+    out.putReg(rd);
+    out.put(",[");
+    out.putReg(rn);
+
+    if constexpr (pre_index)
+        out.put(increment ? "," : ",-");
+    else
+        out.put(increment ? "]," : "-],");
+
+    if constexpr (imm_op)
     {
         uint lower = bit::seq<0, 4>(instr);
         uint upper = bit::seq<8, 4>(instr);
-        offset = hex((upper << 4) | lower);
+        out.putHex((upper << 4) | lower);
     }
     else
     {
         uint rm = bit::seq<0, 4>(instr);
-        offset = reg(rm);
+        out.putReg(rm);
     }
 
-    const auto mnemonic = fmt::format(
-        FMT_COMPILE("{}{}{}{}"),
-        load ? "ldr" : "str",
-        sign ? "s" : "",
-        half ? "h" : "b",
-        condition(instr));
-
-    if (pre_index)
-    {
-        return fmt::format(
-            FMT_COMPILE(MNEMONIC"{},[{},{}{}]{}"),
-            mnemonic,
-            reg(rd),
-            reg(rn),
-            increment ? "" : "-",
-            offset,
-            writeback ? "!" : "");
-    }
-    else
-    {
-        return fmt::format(
-            FMT_COMPILE(MNEMONIC"{},[{}{}],{}"),
-            mnemonic,
-            reg(rd),
-            reg(rn),
-            increment ? "" : "-",
-            offset);
-    }
+    if constexpr (pre_index)
+        out.put(writeback ? "]!" : "]");
 }
 
-std::string Arm_BlockDataTransfer(u32 instr)
+template<u32 Instr>
+void Arm_BlockDataTransfer(Emitter& out, u32 instr, u32)
 {
-    static constexpr const char* kSuffixes[2][4] = {
+    static constexpr std::string_view kSuffixes[2][4] = {
         { "ed", "ea", "fd", "fa" },
         { "fa", "fd", "ea", "ed" }
     };
 
-    uint rlist     = bit::seq< 0, 16>(instr);
-    uint rn        = bit::seq<16,  4>(instr);
-    uint load      = bit::seq<20,  1>(instr);
-    uint writeback = bit::seq<21,  1>(instr);
-    uint user_mode = bit::seq<22,  1>(instr);
-    uint opcode    = bit::seq<23,  2>(instr);
+    constexpr uint load      = bit::seq<20, 1>(Instr);
+    constexpr uint writeback = bit::seq<21, 1>(Instr);
+    constexpr uint user_mode = bit::seq<22, 1>(Instr);
+    constexpr uint opcode    = bit::seq<23, 2>(Instr);
 
-    const auto mnemonic = fmt::format(
-        FMT_COMPILE("{}{}{}"),
-        load ? "ldm" : "stm",
-        kSuffixes[load][opcode],
-        condition(instr));
+    uint rlist = bit::seq< 0, 16>(instr);
+    uint rn    = bit::seq<16,  4>(instr);
 
-    return fmt::format(
-        FMT_COMPILE(MNEMONIC"{}{},{}{}"),
-        mnemonic,
-        reg(rn),
-        writeback ? "!" : "",
-        ::rlist(rlist),
-        user_mode ? "^" : "");
+    out.put(load ? "ldm" : "stm");
+    out.put(kSuffixes[load][opcode]);
+    out.putCond(instr);
+
+    out.putReg(rn);
+    out.put(writeback ? "!," : ",");
+    ::rlist(out, rlist);
+
+    if constexpr (user_mode)
+        out.put('^');
 }
 
-std::string Arm_SingleDataSwap(u32 instr)
+template<u32 Instr>
+void Arm_SingleDataSwap(Emitter& out, u32 instr, u32)
 {
-    uint rm   = bit::seq< 0, 4>(instr);
-    uint rd   = bit::seq<12, 4>(instr);
-    uint rn   = bit::seq<16, 4>(instr);
-    uint byte = bit::seq<22, 1>(instr);
+    constexpr uint byte = bit::seq<22, 1>(Instr);
 
-    const auto mnemonic = fmt::format(
-        FMT_COMPILE("swp{}{}"),
-        byte ? "b" : "",
-        condition(instr));
+    uint rm = bit::seq< 0, 4>(instr);
+    uint rd = bit::seq<12, 4>(instr);
+    uint rn = bit::seq<16, 4>(instr);
 
-    return fmt::format(
-        FMT_COMPILE(MNEMONIC"{},{},[{}]"),
-        mnemonic,
-        reg(rd),
-        reg(rm),
-        reg(rn));
+    out.put("swp");
+    out.put(byte ? "b" : "");
+    out.putCond(instr);
+    out.putReg(rd);
+    out.put(',');
+    out.putReg(rm);
+    out.put(",[");
+    out.putReg(rn);
+    out.put(']');
 }
 
-std::string Arm_SoftwareInterrupt(u32 instr)
+template<u32 Instr>
+void Arm_SoftwareInterrupt(Emitter& out, u32 instr, u32)
 {
     uint comment = bit::seq<16, 8>(instr);
 
-    const auto function = comment < kBiosFunctions.size()
-        ? kBiosFunctions[comment]
-        : "Unknown";
-
-    return fmt::format(
-        FMT_COMPILE(MNEMONIC"{}"),
-        "swi",
-        function);
+    out.putMnemonic("swi");
+    out.put(biosFunction(comment));
 }
 
-std::string Thumb_MoveShiftedRegister(u16 instr)
+template<u16 Instr>
+void Thumb_MoveShiftedRegister(Emitter& out, u16 instr, u32, u32)
 {
-    static constexpr const char* kMnemonics[4] = {
+    static constexpr std::string_view kMnemonics[4] = {
         "lsl", "lsr", "asr", "???"
     };
 
-    uint rd     = bit::seq< 0, 3>(instr);
-    uint rs     = bit::seq< 3, 3>(instr);
-    uint amount = bit::seq< 6, 5>(instr);
-    uint opcode = bit::seq<11, 2>(instr);
+    constexpr uint amount = bit::seq< 6, 5>(Instr);
+    constexpr uint opcode = bit::seq<11, 2>(Instr);
+
+    uint rd = bit::seq<0, 3>(instr);
+    uint rs = bit::seq<3, 3>(instr);
 
-    return fmt::format(
-        FMT_COMPILE(MNEMONIC"{},{},{}"),
-        kMnemonics[opcode],
-        reg(rd),
-        reg(rs),
-        hex(amount));
+    out.putMnemonic(kMnemonics[opcode]);
+    out.putReg(rd);
+    out.put(',');
+    out.putReg(rs);
+    out.put(',');
+    out.putHex(amount);
 }
 
-std::string Thumb_AddSubtract(u16 instr)
+template<u16 Instr>
+void Thumb_AddSubtract(Emitter& out, u16 instr, u32, u32)
 {
-    uint rd     = bit::seq< 0, 3>(instr);
-    uint rs     = bit::seq< 3, 3>(instr);
-    uint rn     = bit::seq< 6, 3>(instr);
-    uint sub    = bit::seq< 9, 1>(instr);
-    uint imm_op = bit::seq<10, 1>(instr);
+    constexpr uint rn     = bit::seq< 6, 3>(Instr);
+    constexpr uint sub    = bit::seq< 9, 1>(Instr);
+    constexpr uint imm_op = bit::seq<10, 1>(Instr);
+
+    uint rd = bit::seq<0, 3>(instr);
+    uint rs = bit::seq<3, 3>(instr);
 
-    if (imm_op && rn == 0)
+    if constexpr (imm_op && rn == 0)
     {
-        return fmt::format(
-            FMT_COMPILE(MNEMONIC"{},{}"),
-            "mov",
-            reg(rd),
-            reg(rs));
+        out.putMnemonic("mov");
+        out.putReg(rd);
+        out.put(',');
+        out.putReg(rs);
     }
     else
     {
-        return fmt::format(
-            FMT_COMPILE(MNEMONIC"{},{},{}"),
-            sub ? "sub" : "add",
-            reg(rd),
-            reg(rs),
-            imm_op ? hex(rn) : reg(rn));
+        out.putMnemonic(sub ? "sub" : "add");
+        out.putReg(rd);
+        out.put(',');
+        out.putReg(rs);
+        out.put(',');
+
+        if constexpr (imm_op)
+            out.putHex(rn);
+        else
+            out.putReg(rn);
     }
 }
 
-std::string Thumb_ImmediateOperations(u16 instr)
+template<u16 Instr>
+void Thumb_ImmediateOperations(Emitter& out, u16 instr, u32, u32)
 {
-    static constexpr const char* kMnemonics[4] = {
+    static constexpr std::string_view kMnemonics[4] = {
         "mov", "cmp", "add", "sub"
     };
 
-    uint amount = bit::seq< 0, 8>(instr);
-    uint rd     = bit::seq< 8, 3>(instr);
-    uint opcode = bit::seq<11, 2>(instr);
+    constexpr uint rd     = bit::seq< 8, 3>(Instr);
+    constexpr uint opcode = bit::seq<11, 2>(Instr);
+
+    uint amount = bit::seq<0, 8>(instr);
 
-    return fmt::format(
-        FMT_COMPILE(MNEMONIC"{},{}"),
-        kMnemonics[opcode],
-        reg(rd),
-        hex(amount));
+    out.putMnemonic(kMnemonics[opcode]);
+    out.putReg(rd);
+    out.put(',');
+    out.putHex(amount);
 }
 
-std::string Thumb_AluOperations(u16 instr)
+template<u16 Instr>
+void Thumb_AluOperations(Emitter& out, u16 instr, u32, u32)
 {
-    static constexpr const char* kMnemonics[16] = {
+    static constexpr std::string_view kMnemonics[16] = {
         "and", "eor", "lsl", "lsr",
         "asr", "adc", "sbc", "ror",
         "tst", "neg", "cmp", "cmn",
         "orr", "mul", "bic", "mvn"
     };
 
-    uint rd     = bit::seq<0, 3>(instr);
-    uint rs     = bit::seq<3, 3>(instr);
-    uint opcode = bit::seq<6, 4>(instr);
+    constexpr uint opcode = bit::seq<6, 4>(Instr);
 
-    return fmt::format(
-        FMT_COMPILE(MNEMONIC"{},{}"),
-        kMnemonics[opcode],
-        reg(rd),
-        reg(rs));
+    uint rd = bit::seq<0, 3>(instr);
+    uint rs = bit::seq<3, 3>(instr);
+
+    out.putMnemonic(kMnemonics[opcode]);
+    out.putReg(rd);
+    out.put(',');
+    out.putReg(rs);
 }
 
-std::string Thumb_HighRegisterOperations(u16 instr)
+template<u16 Instr>
+void Thumb_HighRegisterOperations(Emitter& out, u16 instr, u32, u32)
 {
     enum Opcode
     {
@@ -699,309 +614,355 @@ std::string Thumb_HighRegisterOperations(u16 instr)
         kOpcodeBx
     };
 
-    static constexpr const char* kMnemonics[4] = {
+    static constexpr std::string_view kMnemonics[4] = {
         "add", "cmp", "mov", "bx"
     };
 
-    uint rd     = bit::seq<0, 3>(instr);
-    uint rs     = bit::seq<3, 3>(instr);
-    uint hs     = bit::seq<6, 1>(instr);
-    uint hd     = bit::seq<7, 1>(instr);
-    uint opcode = bit::seq<8, 2>(instr);
+    constexpr uint hs     = bit::seq<6, 1>(Instr);
+    constexpr uint hd     = bit::seq<7, 1>(Instr);
+    constexpr uint opcode = bit::seq<8, 2>(Instr);
+
+    uint rd = bit::seq<0, 3>(instr);
+    uint rs = bit::seq<3, 3>(instr);
 
     rs |= hs << 3;
     rd |= hd << 3;
 
-    if (opcode == kOpcodeBx)
-    {
-        return fmt::format(
-            FMT_COMPILE(MNEMONIC"{}"),
-            kMnemonics[opcode],
-            reg(rs));
-    }
-    else
+    out.putMnemonic(kMnemonics[opcode]);
+
+    if constexpr (opcode != kOpcodeBx)
     {
-        return fmt::format(
-            FMT_COMPILE(MNEMONIC"{},{}"),
-            kMnemonics[opcode],
-            reg(rd),
-            reg(rs));
+        out.putReg(rd);
+        out.put(',');
     }
+    out.putReg(rs);
 }
 
-std::string Thumb_LoadPcRelative(u16 instr, u32 pc)
+template<u16 Instr>
+void Thumb_LoadPcRelative(Emitter& out, u16 instr, u32 pc, u32)
 {
+    constexpr uint rd = bit::seq<8, 3>(Instr);
+
     uint offset = bit::seq<0, 8>(instr);
-    uint rd     = bit::seq<8, 3>(instr);
 
-    return fmt::format(
-        FMT_COMPILE(MNEMONIC"{},[{}]"),
-        "ldr",
-        reg(rd),
-        hex((pc & ~0x3) + (offset<< 2)));
+    out.putMnemonic("ldr");
+    out.putReg(rd);
+    out.put(",[");
+    out.putHex((pc & ~0x3) + (offset << 2));
+    out.put(']');
 }
 
-std::string Thumb_LoadStoreRegisterOffset(u16 instr)
+template<u16 Instr>
+void Thumb_LoadStoreRegisterOffset(Emitter& out, u16 instr, u32, u32)
 {
-    static constexpr const char* kMnemonics[4] = {
+    static constexpr std::string_view kMnemonics[4] = {
         "str", "strb", "ldr", "ldrb"
     };
 
-    uint rd     = bit::seq< 0, 3>(instr);
-    uint rb     = bit::seq< 3, 3>(instr);
-    uint ro     = bit::seq< 6, 3>(instr);
-    uint opcode = bit::seq<10, 2>(instr);
+    constexpr uint ro     = bit::seq< 6, 3>(Instr);
+    constexpr uint opcode = bit::seq<10, 2>(Instr);
 
-    return fmt::format(
-        FMT_COMPILE(MNEMONIC"{},[{},{}]"),
-        kMnemonics[opcode],
-        reg(rd),
-        reg(rb),
-        reg(ro));
+    uint rd = bit::seq<0, 3>(instr);
+    uint rb = bit::seq<3, 3>(instr);
+
+    out.putMnemonic(kMnemonics[opcode]);
+    out.putReg(rd);
+    out.put(",[");
+    out.putReg(rb);
+    out.put(',');
+    out.putReg(ro);
+    out.put(']');
 }
 
-std::string Thumb_LoadStoreByteHalf(u16 instr)
+template<u16 Instr>
+void Thumb_LoadStoreByteHalf(Emitter& out, u16 instr, u32, u32)
 {
-    static constexpr const char* kMnemonics[4] = {
+    static constexpr std::string_view kMnemonics[4] = {
         "strh", "ldrsb", "ldrh", "ldrsh"
     };
 
-    uint rd     = bit::seq< 0, 3>(instr);
-    uint rb     = bit::seq< 3, 3>(instr);
-    uint ro     = bit::seq< 6, 3>(instr);
-    uint opcode = bit::seq<10, 2>(instr);
+    constexpr uint ro     = bit::seq< 6, 3>(Instr);
+    constexpr uint opcode = bit::seq<10, 2>(Instr);
+
+    uint rd = bit::seq<0, 3>(instr);
+    uint rb = bit::seq<3, 3>(instr);
 
-    return fmt::format(
-        FMT_COMPILE(MNEMONIC"{},[{},{}]"),
-        kMnemonics[opcode],
-        reg(rd),
-        reg(rb),
-        reg(ro));
+    out.putMnemonic(kMnemonics[opcode]);
+    out.putReg(rd);
+    out.put(",[");
+    out.putReg(rb);
+    out.put(',');
+    out.putReg(ro);
+    out.put(']');
 }
 
-std::string Thumb_LoadStoreImmediateOffset(u16 instr)
+template<u16 Instr>
+void Thumb_LoadStoreImmediateOffset(Emitter& out, u16 instr, u32, u32)
 {
-    static constexpr const char* kMnemonics[4] = {
+    static constexpr std::string_view kMnemonics[4] = {
         "str", "ldr", "strb", "ldrb"
     };
 
-    uint rd     = bit::seq< 0, 3>(instr);
-    uint rb     = bit::seq< 3, 3>(instr);
-    uint offset = bit::seq< 6, 5>(instr);
-    uint opcode = bit::seq<11, 2>(instr);
+    constexpr uint offset = bit::seq< 6, 5>(Instr) << (~bit::seq<11, 2>(Instr) & 0x2);
+    constexpr uint opcode = bit::seq<11, 2>(Instr);
 
-    offset <<= ~opcode & 0x2;
+    uint rd = bit::seq<0, 3>(instr);
+    uint rb = bit::seq<3, 3>(instr);
 
-    return fmt::format(
-        FMT_COMPILE(MNEMONIC"{},[{},{}]"),
-        kMnemonics[opcode],
-        reg(rd),
-        reg(rb),
-        hex(offset));
+    out.putMnemonic(kMnemonics[opcode]);
+    out.putReg(rd);
+    out.put(",[");
+    out.putReg(rb);
+    out.put(',');
+    out.putHex(offset);
+    out.put(']');
 }
 
-std::string Thumb_LoadStoreHalf(u16 instr)
+template<u16 Instr>
+void Thumb_LoadStoreHalf(Emitter& out, u16 instr, u32, u32)
 {
-    uint rd     = bit::seq< 0, 3>(instr);
-    uint rb     = bit::seq< 3, 3>(instr);
-    uint offset = bit::seq< 6, 5>(instr);
-    uint load   = bit::seq<11, 1>(instr);
+    constexpr uint offset = bit::seq< 6, 5>(Instr) << 1;
+    constexpr uint load   = bit::seq<11, 1>(Instr);
 
-    offset <<= 1;
+    uint rd = bit::seq<0, 3>(instr);
+    uint rb = bit::seq<3, 3>(instr);
 
-    return fmt::format(
-        FMT_COMPILE(MNEMONIC"{},[{},{}]"),
-        load ? "ldrh" : "strh",
-        reg(rd),
-        reg(rb),
-        hex(offset));
+    out.putMnemonic(load ? "ldrh" : "strh");
+    out.putReg(rd);
+    out.put(",[");
+    out.putReg(rb);
+    out.put(',');
+    out.putHex(offset);
+    out.put(']');
 }
 
-std::string Thumb_LoadStoreSpRelative(u16 instr)
+template<u16 Instr>
+void Thumb_LoadStoreSpRelative(Emitter& out, u16 instr, u32, u32)
 {
-    uint offset = bit::seq< 0, 8>(instr);
-    uint rd     = bit::seq< 8, 3>(instr);
-    uint load   = bit::seq<11, 1>(instr);
+    constexpr uint rd   = bit::seq< 8, 3>(Instr);
+    constexpr uint load = bit::seq<11, 1>(Instr);
+
+    uint offset = bit::seq<0, 8>(instr);
 
     offset <<= 2;
 
-    return fmt::format(
-        FMT_COMPILE(MNEMONIC"{},[sp,{}]"),
-        load ? "ldr" : "str",
-        reg(rd),
-        hex(offset));
+    out.putMnemonic(load ? "ldr" : "str");
+    out.putReg(rd);
+    out.put(",[sp,");
+    out.putHex(offset);
+    out.put(']');
 }
 
-std::string Thumb_LoadRelativeAddress(u16 instr, u32 pc)
+template<u16 Instr>
+void Thumb_LoadRelativeAddress(Emitter& out, u16 instr, u32 pc, u32)
 {
-    uint offset = bit::seq< 0, 8>(instr);
-    uint rd     = bit::seq< 8, 3>(instr);
-    uint sp     = bit::seq<11, 1>(instr);
+    constexpr uint rd = bit::seq< 8, 3>(Instr);
+    constexpr uint sp = bit::seq<11, 1>(Instr);
+
+    uint offset = bit::seq<0, 8>(instr);
 
     offset <<= 2;
 
-    if (sp)
+    out.putMnemonic("add");
+    out.putReg(rd);
+
+    if constexpr (sp)
     {
-        return fmt::format(
-            FMT_COMPILE(MNEMONIC"{},sp,{}"),
-            "add",
-            reg(rd), 
-            hex(offset));
+        out.put(",sp,");
+        out.putHex(offset);
     }
     else
     {
-        return fmt::format(
-            FMT_COMPILE(MNEMONIC"{},={}"),
-            "add",
-            reg(rd),
-            hex((pc & ~0x3) + offset));
+        out.put(",=");
+        out.putHex((pc & ~0x3) + offset);
     }
 }
 
-std::string Thumb_AddOffsetSp(u16 instr)
+template<u16 Instr>
+void Thumb_AddOffsetSp(Emitter& out, u16 instr, u32, u32)
 {
+    constexpr uint sign = bit::seq<7, 1>(Instr);
+
     uint offset = bit::seq<0, 7>(instr);
-    uint sign   = bit::seq<7, 1>(instr);
 
     offset <<= 2;
 
-    return fmt::format(
-        FMT_COMPILE(MNEMONIC"sp,{}{}"),
-        "add",
-        sign ? "-" : "",
-        hex(offset));
+    out.putMnemonic("add");
+    out.put(sign ? "sp,-" : "sp,");
+    out.putHex(offset);
 }
 
-std::string Thumb_PushPopRegisters(u16 instr)
+template<u16 Instr>
+void Thumb_PushPopRegisters(Emitter& out, u16 instr, u32, u32)
 {
-    uint rlist = bit::seq< 0, 8>(instr);
-    uint rbit  = bit::seq< 8, 1>(instr);
-    uint pop   = bit::seq<11, 1>(instr);
+    constexpr uint rbit = bit::seq< 8, 1>(Instr);
+    constexpr uint pop  = bit::seq<11, 1>(Instr);
+
+    uint rlist = bit::seq<0, 8>(instr);
 
     rlist |= rbit << (pop ? 15 : 14);
 
-    return fmt::format(
-        FMT_COMPILE(MNEMONIC"{}"),
-        pop ? "pop" : "push",
-        ::rlist(rlist));
+    out.putMnemonic(pop ? "pop" : "push");
+    ::rlist(out, rlist);
 }
 
-std::string Thumb_LoadStoreMultiple(u16 instr)
+template<u16 Instr>
+void Thumb_LoadStoreMultiple(Emitter& out, u16 instr, u32, u32)
 {
-    uint rlist = bit::seq< 0, 8>(instr);
-    uint rb    = bit::seq< 8, 3>(instr);
-    uint load  = bit::seq<11, 1>(instr);
+    constexpr uint rb   = bit::seq< 8, 3>(Instr);
+    constexpr uint load = bit::seq<11, 1>(Instr);
 
-    return fmt::format(
-        FMT_COMPILE(MNEMONIC"{}!,{}"),
-        load ? "ldmia" : "stmia",
-        reg(rb),
-        ::rlist(rlist));
+    uint rlist = bit::seq<0, 8>(instr);
+
+    out.putMnemonic(load ? "ldmia" : "stmia");
+    out.putReg(rb);
+    out.put("!,");
+    ::rlist(out, rlist);
 }
 
-std::string Thumb_ConditionalBranch(u16 instr, u32 pc)
+template<u16 Instr>
+void Thumb_ConditionalBranch(Emitter& out, u16 instr, u32 pc, u32)
 {
-    static constexpr const char* kMnemonics[16] = {
+    static constexpr std::string_view kMnemonics[16] = {
         "beq", "bne", "bcs", "bcc",
         "bmi", "bpl", "bvs", "bvc",
         "bhi", "bls", "bge", "blt",
         "bgt", "ble", "b",   "b??"
     };
 
-    uint offset    = bit::seq<0, 8>(instr);
-    uint condition = bit::seq<8, 4>(instr);
-
-    offset = bit::signEx<8>(offset);
-    offset <<= 1;
+    constexpr uint condition = bit::seq<8, 4>(Instr);
 
-    return fmt::format(
-        FMT_COMPILE(MNEMONIC"{}"),
-        kMnemonics[condition],
-        hex(pc + offset));
+    out.putMnemonic(kMnemonics[condition]);
+    out.putHex(thumbConditionalTarget(instr, pc));
 }
 
-std::string Thumb_SoftwareInterrupt(u16 instr)
+template<u16 Instr>
+void Thumb_SoftwareInterrupt(Emitter& out, u16 instr, u32, u32)
 {
     uint comment = bit::seq<0, 8>(instr);
 
-    const auto function = comment < kBiosFunctions.size()
-        ? kBiosFunctions[comment]
-        : "Unknown";
+    out.putMnemonic("swi");
+    out.put(biosFunction(comment));
+}
 
-    return fmt::format(
-        FMT_COMPILE(MNEMONIC"{}"),
-        "swi",
-        function);
+template<u16 Instr>
+void Thumb_UnconditionalBranch(Emitter& out, u16 instr, u32 pc, u32)
+{
+    out.putMnemonic("b");
+    out.putHex(thumbBranchTarget(instr, pc));
 }
 
-std::string Thumb_UnconditionalBranch(u16 instr, u32 pc)
+template<u16 Instr>
+void Thumb_LongBranchLink(Emitter& out, u16 instr, u32, u32 lr)
 {
-    uint offset = bit::seq<0, 11>(instr);
+    constexpr uint second = bit::seq<11, 1>(Instr);
 
-    offset = bit::signEx<11>(offset);
-    offset <<= 1;
+    out.putMnemonic("bl");
 
-    return fmt::format(
-        FMT_COMPILE(MNEMONIC"{}"),
-        "b",
-        hex(pc + offset));
+    if constexpr (second)
+        out.putHex(thumbLongBranchTarget(instr, lr));
+    else
+        out.put("<setup>");
 }
 
-std::string Thumb_LongBranchLink(u16 instr, u32 lr)
+void Arm_Undefined(Emitter& out, u32, u32)
 {
-    uint offset = bit::seq< 0, 11>(instr);
-    uint second = bit::seq<11,  1>(instr);
+    out.put("Undefined");
+}
 
-    offset <<= 1;
+void Thumb_Undefined(Emitter& out, u16, u32, u32)
+{
+    out.put("Undefined");
+}
 
-    return fmt::format(
-        FMT_COMPILE(MNEMONIC"{}"),
-        "bl",
-        second ? hex(lr + offset) : "<setup>");
+using ArmHandler   = void(*)(Emitter&, u32, u32);
+using ThumbHandler = void(*)(Emitter&, u16, u32, u32);
+
+template<uint Hash>
+constexpr ArmHandler armHandler()
+{
+    constexpr auto kInstr   = dehashArm(Hash);
+    constexpr auto kDecoded = decodeArm(Hash);
+
+    if constexpr (kDecoded == InstructionArm::BranchExchange)         return &Arm_BranchExchange<0>;
+    if constexpr (kDecoded == InstructionArm::BranchLink)             return &Arm_BranchLink<kInstr & 0x0100'0000>;
+    if constexpr (kDecoded == InstructionArm::DataProcessing)         return &Arm_DataProcessing<kInstr & (bit::seq<25, 1>(kInstr) ? 0x03F0'0000 : 0x03F0'0070)>;
+    if constexpr (kDecoded == InstructionArm::StatusTransfer)         return &Arm_StatusTransfer<kInstr & 0x0260'0000>;
+    if constexpr (kDecoded == InstructionArm::Multiply)               return &Arm_Multiply<kInstr & 0x0030'0000>;
+    if constexpr (kDecoded == InstructionArm::MultiplyLong)           return &Arm_MultiplyLong<kInstr & 0x0070'0000>;
+    if constexpr (kDecoded == InstructionArm::SingleDataTransfer)     return &Arm_SingleDataTransfer<kInstr & (bit::seq<25, 1>(kInstr) ? 0x03F0'0070 : 0x03F0'0000)>;
+    if constexpr (kDecoded == InstructionArm::HalfSignedDataTransfer) return &Arm_HalfSignedDataTransfer<kInstr & 0x01F0'0060>;
+    if constexpr (kDecoded == InstructionArm::BlockDataTransfer)      return &Arm_BlockDataTransfer<kInstr & 0x01F0'0000>;
+    if constexpr (kDecoded == InstructionArm::SingleDataSwap)         return &Arm_SingleDataSwap<kInstr & 0x0040'0000>;
+    if constexpr (kDecoded == InstructionArm::SoftwareInterrupt)      return &Arm_SoftwareInterrupt<0>;
+    return &Arm_Undefined;
+}
+
+template<uint Hash>
+constexpr ThumbHandler thumbHandler()
+{
+    constexpr auto kInstr   = dehashThumb(Hash);
+    constexpr auto kDecoded = decodeThumb(Hash);
+
+    if constexpr (kDecoded == InstructionThumb::MoveShiftedRegister)      return &Thumb_MoveShiftedRegister<kInstr>;
+    if constexpr (kDecoded == InstructionThumb::AddSubtract)              return &Thumb_AddSubtract<kInstr>;
+    if constexpr (kDecoded == InstructionThumb::ImmediateOperations)      return &Thumb_ImmediateOperations<kInstr>;
+    if constexpr (kDecoded == InstructionThumb::AluOperations)            return &Thumb_AluOperations<kInstr>;
+    if constexpr (kDecoded == InstructionThumb::HighRegisterOperations)   return &Thumb_HighRegisterOperations<kInstr>;
+    if constexpr (kDecoded == InstructionThumb::LoadPcRelative)           return &Thumb_LoadPcRelative<kInstr>;
+    if constexpr (kDecoded == InstructionThumb::LoadStoreRegisterOffset)  return &Thumb_LoadStoreRegisterOffset<kInstr>;
+    if constexpr (kDecoded == InstructionThumb::LoadStoreByteHalf)        return &Thumb_LoadStoreByteHalf<kInstr>;
+    if constexpr (kDecoded == InstructionThumb::LoadStoreImmediateOffset) return &Thumb_LoadStoreImmediateOffset<kInstr>;
+    if constexpr (kDecoded == InstructionThumb::LoadStoreHalf)            return &Thumb_LoadStoreHalf<kInstr>;
+    if constexpr (kDecoded == InstructionThumb::LoadStoreSpRelative)      return &Thumb_LoadStoreSpRelative<kInstr & 0x0F00>;
+    if constexpr (kDecoded == InstructionThumb::LoadRelativeAddress)      return &Thumb_LoadRelativeAddress<kInstr & 0x0F00>;
+    if constexpr (kDecoded == InstructionThumb::AddOffsetSp)              return &Thumb_AddOffsetSp<kInstr & 0x0080>;
+    if constexpr (kDecoded == InstructionThumb::PushPopRegisters)         return &Thumb_PushPopRegisters<kInstr & 0x0900>;
+    if constexpr (kDecoded == InstructionThumb::LoadStoreMultiple)        return &Thumb_LoadStoreMultiple<kInstr & 0x0F00>;
+    if constexpr (kDecoded == InstructionThumb::ConditionalBranch)        return &Thumb_ConditionalBranch<kInstr & 0x0F00>;
+    if constexpr (kDecoded == InstructionThumb::SoftwareInterrupt)        return &Thumb_SoftwareInterrupt<0>;
+    if constexpr (kDecoded == InstructionThumb::UnconditionalBranch)      return &Thumb_UnconditionalBranch<0>;
+    if constexpr (kDecoded == InstructionThumb::LongBranchLink)           return &Thumb_LongBranchLink<kInstr & 0x0800>;
+    return &Thumb_Undefined;
+}
+
+template<uint... Hashes>
+constexpr std::array<ArmHandler, sizeof...(Hashes)> makeArmHandlers(std::integer_sequence<uint, Hashes...>)
+{
+    return { armHandler<Hashes>()... };
+}
+
+template<uint... Hashes>
+constexpr std::array<ThumbHandler, sizeof...(Hashes)> makeThumbHandlers(std::integer_sequence<uint, Hashes...>)
+{
+    return { thumbHandler<Hashes>()... };
+}
+
+static constexpr auto kArmHandlers   = makeArmHandlers(std::make_integer_sequence<uint, 4096>());
+static constexpr auto kThumbHandlers = makeThumbHandlers(std::make_integer_sequence<uint, 1024>());
+
+char* disassemble(u32 instr, u32 pc, char* out)
+{
+    Emitter emitter(out);
+    kArmHandlers[hashArm(instr)](emitter, instr, pc);
+    return emitter.end();
+}
+
+char* disassemble(u16 instr, u32 pc, u32 lr, char* out)
+{
+    Emitter emitter(out);
+    kThumbHandlers[hashThumb(instr)](emitter, instr, pc, lr);
+    return emitter.end();
 }
 
 std::string disassemble(u32 instr, u32 pc)
 {
-    switch (decodeArm(hashArm(instr)))
-    {
-    case InstructionArm::BranchExchange:         return Arm_BranchExchange(instr);
-    case InstructionArm::BranchLink:             return Arm_BranchLink(instr, pc);
-    case InstructionArm::DataProcessing:         return Arm_DataProcessing(instr, pc);
-    case InstructionArm::StatusTransfer:         return Arm_StatusTransfer(instr);
-    case InstructionArm::Multiply:               return Arm_Multiply(instr);
-    case InstructionArm::MultiplyLong:           return Arm_MultiplyLong(instr);
-    case InstructionArm::SingleDataTransfer:     return Arm_SingleDataTransfer(instr);
-    case InstructionArm::HalfSignedDataTransfer: return Arm_HalfSignedDataTransfer(instr);
-    case InstructionArm::BlockDataTransfer:      return Arm_BlockDataTransfer(instr);
-    case InstructionArm::SingleDataSwap:         return Arm_SingleDataSwap(instr);
-    case InstructionArm::SoftwareInterrupt:      return Arm_SoftwareInterrupt(instr);
-    }
-    return "Undefined";
+    char buffer[kMaxMnemonicSize];
+    return std::string(buffer, disassemble(instr, pc, buffer));
 }
 
 std::string disassemble(u16 instr, u32 pc, u32 lr)
 {
-    switch (decodeThumb(hashThumb(instr)))
-    {
-    case InstructionThumb::MoveShiftedRegister:      return Thumb_MoveShiftedRegister(instr);
-    case InstructionThumb::AddSubtract:              return Thumb_AddSubtract(instr);
-    case InstructionThumb::ImmediateOperations:      return Thumb_ImmediateOperations(instr);
-    case InstructionThumb::AluOperations:            return Thumb_AluOperations(instr);
-    case InstructionThumb::HighRegisterOperations:   return Thumb_HighRegisterOperations(instr);
-    case InstructionThumb::LoadPcRelative:           return Thumb_LoadPcRelative(instr, pc);
-    case InstructionThumb::LoadStoreRegisterOffset:  return Thumb_LoadStoreRegisterOffset(instr);
-    case InstructionThumb::LoadStoreByteHalf:        return Thumb_LoadStoreByteHalf(instr);
-    case InstructionThumb::LoadStoreImmediateOffset: return Thumb_LoadStoreImmediateOffset(instr);
-    case InstructionThumb::LoadStoreHalf:            return Thumb_LoadStoreHalf(instr);
-    case InstructionThumb::LoadStoreSpRelative:      return Thumb_LoadStoreSpRelative(instr);
-    case InstructionThumb::LoadRelativeAddress:      return Thumb_LoadRelativeAddress(instr, pc);
-    case InstructionThumb::AddOffsetSp:              return Thumb_AddOffsetSp(instr);
-    case InstructionThumb::PushPopRegisters:         return Thumb_PushPopRegisters(instr);
-    case InstructionThumb::LoadStoreMultiple:        return Thumb_LoadStoreMultiple(instr);
-    case InstructionThumb::ConditionalBranch:        return Thumb_ConditionalBranch(instr, pc);
-    case InstructionThumb::SoftwareInterrupt:        return Thumb_SoftwareInterrupt(instr);
-    case InstructionThumb::UnconditionalBranch:      return Thumb_UnconditionalBranch(instr, pc);
-    case InstructionThumb::LongBranchLink:           return Thumb_LongBranchLink(instr, lr);
-    }
-    return "Undefined";
+    char buffer[kMaxMnemonicSize];
+    return std::string(buffer, disassemble(instr, pc, lr, buffer));
 }
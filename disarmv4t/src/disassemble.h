@@ -4,5 +4,10 @@
 
 #include "int.h"
 
+inline constexpr std::size_t kMaxMnemonicSize = 128;
+
+char* disassemble(u32 instr, u32 pc, char* out);
+char* disassemble(u16 instr, u32 pc, u32 lr, char* out);
+
 std::string disassemble(u32 instr, u32 pc);
 std::string disassemble(u16 instr, u32 pc, u32 lr);
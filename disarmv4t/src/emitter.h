@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstring>
+#include <string_view>
+
+#include "hex.h"
+#include "int.h"
+
+inline constexpr std::string_view kRegs[16] = {
+     "r0", "r1",  "r2",  "r3",
+     "r4", "r5",  "r6",  "r7",
+     "r8", "r9", "r10", "r11",
+    "r12", "sp",  "lr",  "pc"
+};
+
+inline constexpr std::string_view kConditions[16] = {
+    "eq", "ne", "cs", "cc",
+    "mi", "pl", "vs", "vc",
+    "hi", "ls", "ge", "lt",
+    "gt", "le",   "", "nv"
+};
+
+class Emitter
+{
+public:
+    static constexpr std::size_t kMnemonicWidth = 10;
+
+    explicit Emitter(char* cursor)
+        : begin(cursor), cursor(cursor) {}
+
+    char* end() const
+    {
+        return cursor;
+    }
+
+    void put(char c)
+    {
+        *cursor++ = c;
+    }
+
+    void put(std::string_view str)
+    {
+        std::memcpy(cursor, str.data(), str.size());
+        cursor += str.size();
+    }
+
+    template<typename... Parts>
+    void putMnemonic(const Parts&... parts)
+    {
+        (put(parts), ...);
+
+        while (cursor < begin + kMnemonicWidth)
+            *cursor++ = ' ';
+    }
+
+    // Ends an ARM mnemonic with the condition of instr and pads it
+    void putCond(u32 instr)
+    {
+        putMnemonic(kConditions[instr >> 28]);
+    }
+
+    void putReg(uint n)
+    {
+        put(kRegs[n]);
+    }
+
+    void putHex(u32 value)
+    {
+        put("0x");
+        cursor = hex(cursor, value);
+    }
+
+private:
+    char* begin;
+    char* cursor;
+};
@@ -0,0 +1,283 @@
+#include "format.h"
+
+#include <cstring>
+
+#include <shell/fmt.h>
+
+#include "hex.h"
+
+Format::Format(const std::string& format)
+    : format(format)
+{
+    fast = format == kDefaultFormat;
+    fallback = !fast && !compile();
+
+    // Invalid specs throw here instead of on a worker thread
+    if (fallback)
+    {
+        std::string line;
+        render(line, 0, 0, "");
+    }
+}
+
+void Format::render(std::string& out, u32 addr, u32 instr, std::string_view mnemonic) const
+{
+    if (fast)
+    {
+        std::size_t size = out.size();
+        out.resize(size + 20);
+
+        char* prefix = out.data() + size;
+        hex8(prefix, addr);
+        std::memcpy(prefix + 8, "  ", 2);
+        hex8(prefix + 10, instr);
+        std::memcpy(prefix + 18, "  ", 2);
+
+        out.append(mnemonic);
+        return;
+    }
+
+    if (fallback)
+    {
+        fmt::format_to(
+            std::back_inserter(out),
+            format,
+            fmt::arg("addr", addr),
+            fmt::arg("instr", instr),
+            fmt::arg("mnemonic", mnemonic));
+        return;
+    }
+
+    for (const auto& segment : segments)
+    {
+        switch (segment.field)
+        {
+        case Field::Literal:
+            out.append(segment.literal);
+            break;
+
+        case Field::Addr:
+            renderNumber(out, segment, addr);
+            break;
+
+        case Field::Instr:
+            renderNumber(out, segment, instr);
+            break;
+
+        case Field::Mnemonic:
+            renderPadded(out, segment, mnemonic, false);
+            break;
+        }
+    }
+}
+
+bool Format::compile()
+{
+    Segment literal;
+
+    for (std::size_t index = 0; index < format.size(); ++index)
+    {
+        char c = format[index];
+        if (c == '}')
+        {
+            if (index + 1 >= format.size() || format[index + 1] != '}')
+                return false;
+
+            literal.literal.push_back('}');
+            index++;
+            continue;
+        }
+
+        if (c != '{')
+        {
+            literal.literal.push_back(c);
+            continue;
+        }
+
+        if (index + 1 < format.size() && format[index + 1] == '{')
+        {
+            literal.literal.push_back('{');
+            index++;
+            continue;
+        }
+
+        std::size_t end = format.find('}', index);
+        if (end == std::string::npos)
+            return false;
+
+        std::string_view field(format.data() + index + 1, end - index - 1);
+        std::string_view spec;
+
+        std::size_t colon = field.find(':');
+        if (colon != std::string_view::npos)
+        {
+            spec = field.substr(colon + 1);
+            field = field.substr(0, colon);
+        }
+
+        Segment segment;
+        if (field == "addr")
+            segment.field = Field::Addr;
+        else if (field == "instr")
+            segment.field = Field::Instr;
+        else if (field == "mnemonic")
+            segment.field = Field::Mnemonic;
+        else
+            return false;
+
+        if (!parseSpec(spec, segment))
+            return false;
+
+        if (!literal.literal.empty())
+        {
+            segments.push_back(std::move(literal));
+            literal = Segment();
+        }
+        segments.push_back(std::move(segment));
+
+        index = end;
+    }
+
+    if (!literal.literal.empty())
+        segments.push_back(std::move(literal));
+
+    return true;
+}
+
+bool Format::parseSpec(std::string_view spec, Segment& segment) const
+{
+    auto isAlign = [](char c)
+    {
+        return c == '<' || c == '>' || c == '^';
+    };
+
+    std::size_t index = 0;
+    if (spec.size() >= 2 && isAlign(spec[1]) && spec[0] != '{' && spec[0] != '}')
+    {
+        segment.fill  = spec[0];
+        segment.align = spec[1];
+        index = 2;
+    }
+    else if (!spec.empty() && isAlign(spec[0]))
+    {
+        segment.align = spec[0];
+        index = 1;
+    }
+
+    const bool numeric = segment.field != Field::Mnemonic;
+
+    if (index < spec.size() && spec[index] == '#')
+    {
+        if (!numeric)
+            return false;
+
+        segment.prefix = true;
+        index++;
+    }
+
+    if (index < spec.size() && spec[index] == '0')
+    {
+        if (!numeric)
+            return false;
+
+        segment.zero = true;
+        index++;
+
+        // Like fmt, zero padding with an explicit alignment uses '0' as fill
+        if (segment.align)
+            segment.fill = '0';
+    }
+
+    while (index < spec.size() && spec[index] >= '0' && spec[index] <= '9')
+    {
+        segment.width = 10 * segment.width + (spec[index] - '0');
+        index++;
+    }
+
+    if (index < spec.size())
+    {
+        segment.type = spec[index++];
+
+        const char* types = numeric ? "xXdbo" : "s";
+        if (!std::strchr(types, segment.type))
+            return false;
+    }
+    return index == spec.size();
+}
+
+void Format::renderNumber(std::string& out, const Segment& segment, u32 value) const
+{
+    uint base = 10;
+    const char* digits = "0123456789abcdef";
+    const char* prefix = "";
+
+    switch (segment.type)
+    {
+    case 'x': base = 16; prefix = "0x"; break;
+    case 'X': base = 16; prefix = "0X"; digits = "0123456789ABCDEF"; break;
+    case 'b': base = 2;  prefix = "0b"; break;
+    case 'o': base = 8;  prefix = "0";  break;
+    }
+
+    char buffer[34];
+    char* begin = buffer + sizeof(buffer);
+    do
+    {
+        *--begin = digits[value % base];
+        value /= base;
+    }
+    while (value);
+
+    if (segment.prefix && base == 8 && *begin == '0')
+        prefix = "";
+
+    std::string_view text(begin, buffer + sizeof(buffer) - begin);
+
+    if (segment.zero && !segment.align)
+    {
+        std::size_t length = segment.prefix ? std::strlen(prefix) : 0;
+        if (segment.prefix)
+            out.append(prefix);
+        if (segment.width > length + text.size())
+            out.append(segment.width - length - text.size(), '0');
+        out.append(text);
+        return;
+    }
+
+    if (segment.prefix)
+    {
+        std::string number(prefix);
+        number.append(text);
+        renderPadded(out, segment, number, true);
+    }
+    else
+    {
+        renderPadded(out, segment, text, true);
+    }
+}
+
+void Format::renderPadded(std::string& out, const Segment& segment, std::string_view text, bool numeric) const
+{
+    if (segment.width <= text.size())
+    {
+        out.append(text);
+        return;
+    }
+
+    std::size_t padding = segment.width - text.size();
+
+    char align = segment.align;
+    if (!align)
+        align = numeric ? '>' : '<';
+
+    std::size_t before = 0;
+    switch (align)
+    {
+    case '>': before = padding; break;
+    case '^': before = padding / 2; break;
+    }
+
+    out.append(before, segment.fill);
+    out.append(text);
+    out.append(padding - before, segment.fill);
+}
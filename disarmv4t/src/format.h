@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "int.h"
+
+inline constexpr const char* kDefaultFormat = "{addr:08X}  {instr:08X}  {mnemonic}";
+
+class Format
+{
+public:
+    explicit Format(const std::string& format);
+
+    void render(std::string& out, u32 addr, u32 instr, std::string_view mnemonic) const;
+
+private:
+    enum class Field
+    {
+        Literal,
+        Addr,
+        Instr,
+        Mnemonic
+    };
+
+    struct Segment
+    {
+        Field field = Field::Literal;
+        std::string literal;
+        char fill = ' ';
+        char align = 0;
+        char type = 0;
+        bool prefix = false;
+        bool zero = false;
+        uint width = 0;
+    };
+
+    bool compile();
+    bool parseSpec(std::string_view spec, Segment& segment) const;
+    void renderNumber(std::string& out, const Segment& segment, u32 value) const;
+    void renderPadded(std::string& out, const Segment& segment, std::string_view text, bool numeric) const;
+
+    std::string format;
+    std::vector<Segment> segments;
+    bool fast = false;
+    bool fallback = false;
+};
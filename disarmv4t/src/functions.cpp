@@ -0,0 +1,187 @@
+#include "functions.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#include <shell/constants.h>
+#include <shell/fmt.h>
+
+#include "branch.h"
+#include "context.h"
+#include "decode.h"
+#include "pool.h"
+
+std::vector<Function> findFunctions(const u8* data, std::size_t size, u32 addr, bool thumb)
+{
+    const uint width = thumb ? 2 : 4;
+
+    size -= size % width;
+
+    std::vector<u32> starts;
+    std::vector<u32> prologues;
+    std::vector<u32> epilogues;
+
+    auto call = [&](u32 target)
+    {
+        if (target - addr < size && (target - addr) % width == 0)
+            starts.push_back(target);
+    };
+
+    u32 lr = 0;
+    for (std::size_t index = 0; index < size; index += width)
+    {
+        u32 pc = addr + static_cast<u32>(index);
+
+        if (!thumb)
+        {
+            u32 instr;
+            std::memcpy(&instr, data + index, sizeof(instr));
+
+            bool always = bit::seq<28, 4>(instr) == 0xE;
+
+            switch (decodeArm(hashArm(instr)))
+            {
+            case InstructionArm::BranchLink:
+                if (bit::seq<24, 1>(instr))
+                    call(armBranchTarget(instr, pc + 8));
+                break;
+
+            case InstructionArm::BranchExchange:
+                if (always && bit::seq<0, 4>(instr) == 14)
+                    epilogues.push_back(pc);
+                break;
+
+            case InstructionArm::BlockDataTransfer:
+            {
+                uint load  = bit::seq<20, 1>(instr);
+                uint rn    = bit::seq<16, 4>(instr);
+                uint rlist = bit::seq< 0, 16>(instr);
+
+                if (rn != 13 || !bit::seq<21, 1>(instr))
+                    break;
+
+                // stmfd sp!,{...,lr} and ldmfd sp!,{...,pc}
+                if (!load && bit::seq<23, 2>(instr) == 0b10 && (rlist & (1 << 14)))
+                    prologues.push_back(pc);
+                if (load && always && bit::seq<23, 2>(instr) == 0b01 && (rlist & (1 << 15)))
+                    epilogues.push_back(pc);
+                break;
+            }
+
+            default:
+                break;
+            }
+        }
+        else
+        {
+            u16 instr;
+            std::memcpy(&instr, data + index, sizeof(instr));
+
+            switch (decodeThumb(hashThumb(instr)))
+            {
+            case InstructionThumb::LongBranchLink:
+                if (bit::seq<11, 1>(instr))
+                    call(thumbLongBranchTarget(instr, lr));
+                break;
+
+            case InstructionThumb::HighRegisterOperations:
+                if (bit::seq<8, 2>(instr) == 0b11 && bit::seq<3, 4>(instr) == 14)
+                    epilogues.push_back(pc);
+                break;
+
+            case InstructionThumb::PushPopRegisters:
+                if (bit::seq<8, 1>(instr))
+                {
+                    if (bit::seq<11, 1>(instr))
+                        epilogues.push_back(pc);
+                    else
+                        prologues.push_back(pc);
+                }
+                break;
+
+            default:
+                break;
+            }
+
+            lr = thumbLongBranchSetup(instr, pc + 4);
+        }
+    }
+
+    for (std::size_t x = 0; x < prologues.size(); ++x)
+    {
+        u32 limit = x + 1 < prologues.size()
+            ? prologues[x + 1]
+            : addr + static_cast<u32>(size);
+
+        auto epilogue = std::upper_bound(epilogues.begin(), epilogues.end(), prologues[x]);
+        if (epilogue != epilogues.end() && *epilogue < limit)
+            starts.push_back(prologues[x]);
+    }
+
+    if (size > 0)
+        starts.push_back(addr);
+
+    std::sort(starts.begin(), starts.end());
+    starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+
+    std::vector<Function> functions;
+    functions.reserve(starts.size());
+    for (std::size_t x = 0; x < starts.size(); ++x)
+    {
+        u32 end = x + 1 < starts.size()
+            ? starts[x + 1]
+            : addr + static_cast<u32>(size);
+
+        functions.push_back({ starts[x], end });
+    }
+    return functions;
+}
+
+std::vector<std::string> listFunctions(const Format& format, const u8* data, std::size_t size, u32 addr, bool thumb)
+{
+    const auto functions = findFunctions(data, size, addr, thumb);
+
+    std::vector<std::string> blocks(functions.size() + 1);
+    {
+        ThreadPool pool;
+        for (std::size_t x = 0; x < functions.size(); ++x)
+        {
+            pool.submit([&, x]()
+            {
+                const Function& function = functions[x];
+                std::string& text = blocks[x + 1];
+
+                fmt::format_to(std::back_inserter(text), "sub_{:08X}:", function.begin);
+                text.append(shell::kLineBreak);
+
+                DisasmContext context(function.begin, thumb);
+                context.feed(text, format, data + (function.begin - addr), function.end - function.begin);
+                text.append(shell::kLineBreak);
+            });
+        }
+        pool.wait();
+    }
+
+    // Offsets have a fixed width, so the index size is known up front
+    auto index = [&](std::size_t offset)
+    {
+        std::string text;
+        fmt::format_to(std::back_inserter(text), "; functions {}", functions.size());
+        text.append(shell::kLineBreak);
+
+        for (std::size_t x = 0; x < functions.size(); ++x)
+        {
+            fmt::format_to(std::back_inserter(text), "; sub_{0:08X} {0:08X}-{1:08X} {2:016X} {3:016X}",
+                functions[x].begin, functions[x].end, offset, blocks[x + 1].size());
+            text.append(shell::kLineBreak);
+
+            offset += blocks[x + 1].size();
+        }
+        text.append(shell::kLineBreak);
+        return text;
+    };
+
+    blocks[0] = index(index(0).size());
+    return blocks;
+}
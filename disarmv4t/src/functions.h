@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "format.h"
+#include "int.h"
+
+struct Function
+{
+    u32 begin;
+    u32 end;
+};
+
+// Functions start at call targets and at prologues which are followed by an
+// epilogue before the next prologue. They extend up to the next start.
+std::vector<Function> findFunctions(const u8* data, std::size_t size, u32 addr, bool thumb);
+
+// Disassembles every function as a separate pool task. The first block is an
+// index with the file offset and size of each following function section.
+std::vector<std::string> listFunctions(const Format& format, const u8* data, std::size_t size, u32 addr, bool thumb);
@@ -0,0 +1,119 @@
+#include "hex.h"
+
+#include <atomic>
+#include <cstring>
+
+#ifdef _MSC_VER
+#  include <intrin.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#  define HEX_SSSE3 1
+#  include <immintrin.h>
+#  ifdef _MSC_VER
+#    define HEX_TARGET_SSSE3
+#  else
+#    define HEX_TARGET_SSSE3 __attribute__((target("ssse3")))
+#  endif
+#else
+#  define HEX_SSSE3 0
+#endif
+
+static void hex8Scalar(char* out, u32 value)
+{
+    static constexpr char kDigits[16] = {
+        '0', '1', '2', '3', '4', '5', '6', '7',
+        '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
+    };
+
+    for (int x = 7; x >= 0; --x)
+    {
+        out[x] = kDigits[value & 0xF];
+        value >>= 4;
+    }
+}
+
+static uint digits(u32 value)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse(&index, value | 1);
+    return index / 4 + 1;
+#else
+    return (31 - __builtin_clz(value | 1)) / 4 + 1;
+#endif
+}
+
+#if HEX_SSSE3
+
+HEX_TARGET_SSSE3 static void hex8Ssse3(char* out, u32 value)
+{
+    const __m128i digits = _mm_setr_epi8(
+        '0', '1', '2', '3', '4', '5', '6', '7',
+        '8', '9', 'A', 'B', 'C', 'D', 'E', 'F');
+
+    // Reverse the bytes so the most significant nibble ends up first
+    const __m128i reverse = _mm_setr_epi8(3, 2, 1, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i mask = _mm_set1_epi8(0x0F);
+
+    __m128i bytes = _mm_shuffle_epi8(_mm_cvtsi32_si128(static_cast<int>(value)), reverse);
+    __m128i lo = _mm_and_si128(bytes, mask);
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), mask);
+
+    __m128i nibbles = _mm_unpacklo_epi8(hi, lo);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_shuffle_epi8(digits, nibbles));
+}
+
+static bool hasSsse3()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return info[2] & (1 << 9);
+#else
+    return __builtin_cpu_supports("ssse3");
+#endif
+}
+
+#endif
+
+using Hex8 = void(*)(char*, u32);
+
+static Hex8 selectHex8()
+{
+#if HEX_SSSE3
+    if (hasSsse3())
+        return hex8Ssse3;
+#endif
+    return hex8Scalar;
+}
+
+static void resolveHex8(char* out, u32 value);
+
+// Constant initialized, so hex also works while other translation units are
+// initialized. The first call replaces the resolver with the implementation
+// for this CPU.
+static std::atomic<Hex8> dispatch{resolveHex8};
+
+static void resolveHex8(char* out, u32 value)
+{
+    Hex8 hex8 = selectHex8();
+    dispatch.store(hex8, std::memory_order_relaxed);
+    hex8(out, value);
+}
+
+void hex8(char* out, u32 value)
+{
+    dispatch.load(std::memory_order_relaxed)(out, value);
+}
+
+char* hex(char* out, u32 value)
+{
+    uint count = digits(value);
+
+    char buffer[8];
+    hex8(buffer, value);
+    std::memcpy(out, buffer + 8 - count, count);
+
+    return out + count;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "int.h"
+
+// Writes exactly 8 uppercase hex digits
+void hex8(char* out, u32 value);
+
+// Writes uppercase hex digits without leading zeros and returns the end
+char* hex(char* out, u32 value);
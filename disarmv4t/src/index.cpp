@@ -0,0 +1,31 @@
+#include "index.h"
+
+#include <shell/fmt.h>
+
+namespace fs = shell::filesystem;
+
+Index::Index(const fs::path& path, uint interval)
+    : stream(path, std::ios::binary), interval(interval) {}
+
+bool Index::isOpen() const
+{
+    return stream && stream.is_open();
+}
+
+void Index::advance(std::size_t size)
+{
+    base += size;
+}
+
+bool Index::finish()
+{
+    stream.flush();
+    return static_cast<bool>(stream);
+}
+
+void Index::add(u32 addr, u64 offset)
+{
+    char entry[kEntrySize + 1];
+    fmt::format_to(entry, "{:08X} {:016X}\n", addr, offset);
+    stream.write(entry, kEntrySize);
+}
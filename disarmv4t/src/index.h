@@ -0,0 +1,40 @@
+#pragma once
+
+#include <fstream>
+
+#include <shell/filesystem.h>
+
+#include "int.h"
+
+// Sidecar index mapping every nth instruction address to the byte offset of
+// its line. Entries are fixed width text lines "AAAAAAAA OOOOOOOOOOOOOOOO\n"
+// in address order, so readers can binary search the file directly.
+class Index
+{
+public:
+    static constexpr std::size_t kEntrySize = 26;
+
+    Index(const shell::filesystem::path& path, uint interval);
+
+    bool isOpen() const;
+
+    void sample(u32 addr, std::size_t line)
+    {
+        if (--countdown == 0)
+        {
+            countdown = interval;
+            add(addr, base + line);
+        }
+    }
+
+    void advance(std::size_t size);
+    bool finish();
+
+private:
+    void add(u32 addr, u64 offset);
+
+    std::ofstream stream;
+    uint interval;
+    uint countdown = 1;
+    u64 base = 0;
+};
@@ -0,0 +1,221 @@
+#include "listing.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include <shell/constants.h>
+
+#include "branch.h"
+#include "disassemble.h"
+#include "emitter.h"
+
+template<typename Instr>
+static char* decode(Instr instr, u32 addr, u32& lr, char* out)
+{
+    if constexpr (sizeof(Instr) == 4)
+    {
+        return disassemble(instr, addr + 8, out);
+    }
+    else
+    {
+        char* end = disassemble(instr, addr + 4, lr, out);
+        lr = thumbLongBranchSetup(instr, addr + 4);
+        return end;
+    }
+}
+
+static void annotate(std::string& out, const Annotations::Texts& texts)
+{
+    if (!texts[Annotations::kKindType].empty())
+    {
+        out.append("; ");
+        out.append(texts[Annotations::kKindType]);
+        out.append(shell::kLineBreak);
+    }
+
+    if (!texts[Annotations::kKindLabel].empty())
+    {
+        out.append(texts[Annotations::kKindLabel]);
+        out.push_back(':');
+        out.append(shell::kLineBreak);
+    }
+}
+
+static void render(std::string& out, const Format& format, u32 addr, u32 instr, std::string_view mnemonic, bool thumb, const ListingHooks& hooks)
+{
+    if (hooks.cycles)
+        hooks.cycles->split(out, addr);
+
+    if (hooks.index)
+        hooks.index->sample(addr, out.size());
+
+    Annotations::Texts texts;
+    bool annotated = hooks.annotations && hooks.annotations->find(addr, texts);
+    if (annotated)
+        annotate(out, texts);
+
+    std::size_t line = out.size();
+    format.render(out, addr, instr, mnemonic);
+
+    if (annotated && !texts[Annotations::kKindComment].empty())
+    {
+        constexpr std::size_t kColumn = 52;
+
+        std::size_t length = out.size() - line;
+        out.append(length < kColumn ? kColumn - length : 1, ' ');
+        out.append("; ");
+        out.append(texts[Annotations::kKindComment]);
+    }
+
+    if (hooks.cycles)
+        hooks.cycles->annotate(out, line, addr, instr, thumb);
+    else
+        out.append(shell::kLineBreak);
+}
+
+template<typename Instr>
+static void list(std::string& out, const Format& format, const u8* data, std::size_t size, u32 addr, u32& lr, const ListingHooks& hooks)
+{
+    char mnemonic[kMaxMnemonicSize];
+
+    for (std::size_t offset = 0; offset + sizeof(Instr) <= size; offset += sizeof(Instr))
+    {
+        Instr instr;
+        std::memcpy(&instr, data + offset, sizeof(instr));
+
+        char* end = decode(instr, addr, lr, mnemonic);
+        render(out, format, addr, instr, std::string_view(mnemonic, end - mnemonic), sizeof(Instr) == 2, hooks);
+
+        addr += sizeof(Instr);
+    }
+}
+
+// Decodes the whole chunk before rendering it to time both phases
+template<typename Instr>
+static void listPhases(std::string& out, const Format& format, const u8* data, std::size_t size, u32 addr, u32& lr, const ListingHooks& hooks)
+{
+    Profile& profile = *hooks.profile;
+
+    static thread_local std::vector<char> mnemonics;
+    static thread_local std::vector<u8> lengths;
+
+    std::size_t count = size / sizeof(Instr);
+    mnemonics.resize(count * kMaxMnemonicSize);
+    lengths.resize(count);
+
+    {
+        Profile::Timer timer(&profile, Profile::kPhaseDecode);
+
+        u32 pc = addr;
+        for (std::size_t x = 0; x < count; ++x)
+        {
+            Instr instr;
+            std::memcpy(&instr, data + x * sizeof(Instr), sizeof(instr));
+
+            char* mnemonic = mnemonics.data() + x * kMaxMnemonicSize;
+            lengths[x] = static_cast<u8>(decode(instr, pc, lr, mnemonic) - mnemonic);
+
+            pc += sizeof(Instr);
+        }
+    }
+
+    {
+        Profile::Timer timer(&profile, Profile::kPhaseRender);
+
+        for (std::size_t x = 0; x < count; ++x)
+        {
+            Instr instr;
+            std::memcpy(&instr, data + x * sizeof(Instr), sizeof(instr));
+
+            std::string_view mnemonic(mnemonics.data() + x * kMaxMnemonicSize, lengths[x]);
+            render(out, format, addr, instr, mnemonic, sizeof(Instr) == 2, hooks);
+
+            addr += sizeof(Instr);
+        }
+    }
+
+    profile.count(count);
+}
+
+// Emits a data window as .word or .hword lines without decoding it
+template<typename Instr>
+static void listData(std::string& out, const Format& format, const u8* data, std::size_t size, u32 addr, u32& lr, const ListingHooks& hooks)
+{
+    Profile::Timer timer(hooks.profile, Profile::kPhaseRender);
+
+    if (hooks.cycles)
+        hooks.cycles->finish(out);
+
+    // Data has no cycle costs
+    ListingHooks plain = hooks;
+    plain.cycles = nullptr;
+
+    char mnemonic[kMaxMnemonicSize];
+
+    std::size_t count = size / sizeof(Instr);
+    for (std::size_t x = 0; x < count; ++x)
+    {
+        Instr instr;
+        std::memcpy(&instr, data + x * sizeof(Instr), sizeof(instr));
+
+        Emitter emitter(mnemonic);
+        emitter.putMnemonic(sizeof(Instr) == 4 ? ".word" : ".hword");
+        emitter.putHex(instr);
+
+        render(out, format, addr, instr, std::string_view(mnemonic, emitter.end() - mnemonic), sizeof(Instr) == 2, plain);
+
+        if constexpr (sizeof(Instr) == 2)
+            lr = thumbLongBranchSetup(instr, addr + 4);
+
+        addr += sizeof(Instr);
+    }
+
+    if (hooks.profile)
+        hooks.profile->count(count);
+}
+
+static void listCode(std::string& out, const Format& format, const u8* data, std::size_t size, u32 addr, bool thumb, u32& lr, const ListingHooks& hooks)
+{
+    if (hooks.profile)
+    {
+        if (thumb)
+            listPhases<u16>(out, format, data, size, addr, lr, hooks);
+        else
+            listPhases<u32>(out, format, data, size, addr, lr, hooks);
+    }
+    else
+    {
+        if (thumb)
+            list<u16>(out, format, data, size, addr, lr, hooks);
+        else
+            list<u32>(out, format, data, size, addr, lr, hooks);
+    }
+}
+
+void listing(std::string& out, const Format& format, const u8* data, std::size_t size, u32 addr, bool thumb, u32& lr, const ListingHooks& hooks)
+{
+    if (!hooks.data)
+    {
+        listCode(out, format, data, size, addr, thumb, lr, hooks);
+        return;
+    }
+
+    // Split the range at window boundaries and emit data windows as is
+    while (size > 0)
+    {
+        std::size_t length = std::min<std::size_t>(size, hooks.data->windowEnd(addr) - addr);
+
+        if (!hooks.data->isData(addr))
+            listCode(out, format, data, length, addr, thumb, lr, hooks);
+        else if (thumb)
+            listData<u16>(out, format, data, length, addr, lr, hooks);
+        else
+            listData<u32>(out, format, data, length, addr, lr, hooks);
+
+        data += length;
+        size -= length;
+        addr += static_cast<u32>(length);
+    }
+}
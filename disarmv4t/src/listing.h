@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+
+#include "annotations.h"
+#include "classify.h"
+#include "cycles.h"
+#include "format.h"
+#include "index.h"
+#include "int.h"
+#include "profile.h"
+
+struct ListingHooks
+{
+    CycleCounter* cycles = nullptr;
+    Profile* profile = nullptr;
+    Index* index = nullptr;
+    const DataMap* data = nullptr;
+    const Annotations* annotations = nullptr;
+};
+
+void listing(std::string& out, const Format& format, const u8* data, std::size_t size, u32 addr, bool thumb, u32& lr, const ListingHooks& hooks = {});
@@ -1,3 +1,8 @@
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <utility>
+
 #include <shell/bit.h>
 #include <shell/constants.h>
 #include <shell/filesystem.h>
@@ -6,85 +11,548 @@
 #include <shell/main.h>
 #include <shell/options.h>
 
-#include "disassemble.h"
+#include "annotations.h"
+#include "batch.h"
+#include "cfg.h"
+#include "classify.h"
+#include "context.h"
+#include "counters.h"
+#include "cycles.h"
+#include "format.h"
+#include "functions.h"
+#include "index.h"
+#include "listing.h"
+#include "parallel.h"
+#include "pipeline.h"
+#include "profile.h"
+#include "regions.h"
+#include "server.h"
+#include "sink.h"
+#include "source.h"
+#include "trace.h"
+#include "viewer.h"
+#include "watch.h"
 
 namespace fs = shell::filesystem;
 
+// Options that only some modes read
+enum OptionBit : uint
+{
+    kOptionBase        = 1 << 0,
+    kOptionThumb       = 1 << 1,
+    kOptionFormat      = 1 << 2,
+    kOptionCompress    = 1 << 3,
+    kOptionDecompress  = 1 << 4,
+    kOptionCycles      = 1 << 5,
+    kOptionIndex       = 1 << 6,
+    kOptionData        = 1 << 7,
+    kOptionProfile     = 1 << 8,
+    kOptionAnnotations = 1 << 9,
+    kOptionCount       = 10
+};
+
+static constexpr const char* kOptionNames[kOptionCount] =
+{
+    "--base", "--thumb", "--format", "--compress", "--decompress",
+    "--cycles", "--index", "--data", "--profile", "--annotations"
+};
+
+// Base address, mode and format of a listing
+static constexpr uint kOptionsListing = kOptionBase | kOptionThumb | kOptionFormat;
+
+// How a mode is selected on the command line
+enum class ModeKind
+{
+    Flag,
+    Path,
+    Text
+};
+
+struct Mode
+{
+    const char* name;
+    ModeKind kind;
+    uint options;
+};
+
+// Every mode and the options it reads, the plain listing reads all of them
+static constexpr Mode kModes[] =
+{
+    { "--serve",     ModeKind::Path, kOptionFormat                                                              },
+    { "--batch",     ModeKind::Path, kOptionFormat | kOptionCompress                                            },
+    { "--annotate",  ModeKind::Path, kOptionAnnotations                                                         },
+    { "--view",      ModeKind::Flag, kOptionsListing                                                            },
+    { "--counters",  ModeKind::Flag, kOptionsListing | kOptionDecompress                                        },
+    { "--regions",   ModeKind::Path, kOptionFormat | kOptionCompress                                            },
+    { "--watch",     ModeKind::Flag, kOptionsListing                                                            },
+    { "--trace",     ModeKind::Flag, kOptionFormat | kOptionCompress | kOptionDecompress                        },
+    { "--pipeline",  ModeKind::Flag, kOptionsListing | kOptionCompress | kOptionDecompress | kOptionAnnotations },
+    { "--parallel",  ModeKind::Flag, kOptionsListing | kOptionDecompress | kOptionData | kOptionAnnotations     },
+    { "--cfg",       ModeKind::Text, kOptionBase | kOptionThumb | kOptionCompress | kOptionDecompress           },
+    { "--functions", ModeKind::Flag, kOptionsListing | kOptionCompress | kOptionDecompress                      }
+};
+
+// Options that cannot be combined in any mode, including the plain listing
+static constexpr std::pair<OptionBit, OptionBit> kOptionConflicts[] =
+{
+    // Index offsets point into the uncompressed listing
+    { kOptionIndex, kOptionCompress }
+};
+
+static const char* optionName(uint option)
+{
+    uint x = 0;
+    while (!(option & (1 << x)))
+        x++;
+
+    return kOptionNames[x];
+}
+
+static bool isSelected(shell::OptionsResult& result, const Mode& mode)
+{
+    switch (mode.kind)
+    {
+    case ModeKind::Flag:
+        return *result.find<bool>(mode.name);
+
+    case ModeKind::Path:
+        return result.find<fs::path>(mode.name).has_value();
+
+    case ModeKind::Text:
+        return !result.find<std::string>(mode.name)->empty();
+    }
+    return false;
+}
+
+// Rejects combining modes and options the selected mode would ignore
+static void checkConflicts(shell::OptionsResult& result)
+{
+    const bool options[kOptionCount] =
+    {
+        *result.find<u32>("--base") != 0,
+        *result.find<bool>("--thumb"),
+        *result.find<std::string>("--format") != kDefaultFormat,
+        !result.find<std::string>("--compress")->empty(),
+        !result.find<std::string>("--decompress")->empty(),
+        !result.find<std::string>("--cycles")->empty(),
+        *result.find<uint>("--index") != 0,
+        *result.find<uint>("--data") != 0,
+        *result.find<bool>("--profile"),
+        result.find<fs::path>("--annotations").has_value()
+    };
+
+    uint selected = 0;
+    for (uint x = 0; x < kOptionCount; ++x)
+    {
+        if (options[x])
+            selected |= 1 << x;
+    }
+
+    for (const auto& [first, second] : kOptionConflicts)
+    {
+        if ((selected & first) && (selected & second))
+            throw std::runtime_error(fmt::format("Cannot combine {} with {}", optionName(first), optionName(second)));
+    }
+
+    const Mode* mode = nullptr;
+    for (std::size_t x = 0; x < std::size(kModes); ++x)
+    {
+        if (!isSelected(result, kModes[x]))
+            continue;
+
+        if (mode)
+            throw std::runtime_error(fmt::format("Cannot combine {} with {}", mode->name, kModes[x].name));
+
+        mode = &kModes[x];
+    }
+
+    if (!mode)
+        return;
+
+    if (const uint ignored = selected & ~mode->options)
+        throw std::runtime_error(fmt::format("Cannot combine {} with {}", mode->name, optionName(ignored)));
+}
+
 int main(int argc, char* argv[])
 {
     using namespace shell;
 
     Options options("disarmv4t");
-    options.add({   "-b,--base", "Base address", "value"  }, Options::value<u32>(0));
-    options.add({  "-t,--thumb", "Disassemble as Thumb"   }, Options::value<bool>(false));
-    options.add({ "-f,--format", "Output format", "value" }, Options::value<std::string>("{addr:08X}  {instr:08X}  {mnemonic}"));
-    options.add({       "input", "Input file"             }, Options::value<fs::path>()->positional());
-    options.add({      "output", "Output file"            }, Options::value<fs::path>()->positional());
+    options.add({        "-b,--base", "Base address", "value"               }, Options::value<u32>(0));
+    options.add({       "-t,--thumb", "Disassemble as Thumb"                }, Options::value<bool>(false));
+    options.add({      "-f,--format", "Output format", "value"              }, Options::value<std::string>(kDefaultFormat));
+    options.add({       "-s,--serve", "Serve socket", "path"                }, Options::value<fs::path>()->optional());
+    options.add({    "-c,--compress", "Output compression", "value"         }, Options::value<std::string>(""));
+    options.add({       "-r,--trace", "Input is an execution trace"         }, Options::value<bool>(false));
+    options.add({      "-y,--cycles", "Cycle costs for region", "value"     }, Options::value<std::string>(""));
+    options.add({         "-g,--cfg", "Control flow graph", "value"         }, Options::value<std::string>(""));
+    options.add({   "-n,--functions", "Split into functions"                }, Options::value<bool>(false));
+    options.add({     "-p,--profile", "Print phase timings"                 }, Options::value<bool>(false));
+    options.add({       "-a,--batch", "Batch manifest", "path"              }, Options::value<fs::path>()->optional());
+    options.add({       "-w,--watch", "Watch input for changes"             }, Options::value<bool>(false));
+    options.add({       "-i,--index", "Index every nth address", "value"    }, Options::value<uint>(0));
+    options.add({        "-d,--data", "Data threshold in percent", "value"  }, Options::value<uint>(0));
+    options.add({    "-j,--parallel", "Write chunks in parallel"            }, Options::value<bool>(false));
+    options.add({    "-l,--pipeline", "Overlap read, decode and write"      }, Options::value<bool>(false));
+    options.add({ "-o,--annotations", "Annotation database", "path"         }, Options::value<fs::path>()->optional());
+    options.add({    "-e,--annotate", "Add annotations to database", "path" }, Options::value<fs::path>()->optional());
+    options.add({        "-v,--view", "Browse input interactively"          }, Options::value<bool>(false));
+    options.add({     "-m,--regions", "Region map", "path"                  }, Options::value<fs::path>()->optional());
+    options.add({    "-k,--counters", "Print hardware counters"             }, Options::value<bool>(false));
+    options.add({  "-u,--decompress", "Input decompression", "value"        }, Options::value<std::string>(""));
+    options.add({            "input", "Input file"                          }, Options::value<fs::path>()->positional()->optional());
+    options.add({           "output", "Output file"                         }, Options::value<fs::path>()->positional()->optional());
 
     try
     {
         OptionsResult result = options.parse(argc, argv);
+        checkConflicts(result);
 
         auto addr   = *result.find<u32>("--base");
         auto size   = *result.find<bool>("--thumb") ? 2 : 4;
-        auto format = *result.find<std::string>("--format");
-        auto input  = *result.find<fs::path>("input");
-        auto output = *result.find<fs::path>("output");
+        auto format = Format(*result.find<std::string>("--format"));
+
+        if (const auto socket = result.find<fs::path>("--serve"))
+            return serve(*socket, format);
+
+        if (const auto manifest = result.find<fs::path>("--batch"))
+            return batch(*manifest, format, *result.find<std::string>("--compress"));
+
+        if (const auto text = result.find<fs::path>("--annotate"))
+        {
+            const auto database = result.find<fs::path>("--annotations");
+            if (!database)
+                throw std::runtime_error("Expected annotation database");
+
+            if (!Annotations::append(*database, *text))
+            {
+                fmt::print("Cannot write file {}", *database);
+                return 2;
+            }
+            return 0;
+        }
 
-        auto [status, data] = fs::read<std::vector<u8>>(input);
+        const auto input  = result.find<fs::path>("input");
+        const auto output = result.find<fs::path>("output");
 
-        if (status != fs::Status::Ok)
+        if (*result.find<bool>("--view"))
         {
-            fmt::print("Cannot read file {}", input);
+            if (!input)
+                throw std::runtime_error("Expected input");
+
+            return view(*input, format, addr, size == 2);
+        }
+
+        if (*result.find<bool>("--counters"))
+        {
+            if (!input)
+                throw std::runtime_error("Expected input");
+
+            auto source = makeSource(*input, *result.find<std::string>("--decompress"));
+            if (!source)
+            {
+                fmt::print("Cannot read file {}", *input);
+                return 1;
+            }
+
+            auto data = readAll(*source);
+            if (source->isBad())
+            {
+                fmt::print("Cannot read file {}", *input);
+                return 1;
+            }
+
+            printCounters(format, data.data(), data.size(), addr, size == 2);
+            return 0;
+        }
+
+        if (!input || !output)
+            throw std::runtime_error("Expected input and output");
+
+        if (const auto map = result.find<fs::path>("--regions"))
+            return regions(*map, *input, *output, format, *result.find<std::string>("--compress"));
+
+        if (*result.find<bool>("--watch"))
+        {
+            return watch(*input, *output, format, addr, size == 2);
+        }
+
+        constexpr std::size_t kChunkSize = 64 * 1024;
+
+        if (*result.find<bool>("--trace"))
+        {
+            auto source = makeSource(*input, *result.find<std::string>("--decompress"));
+            if (!source)
+            {
+                fmt::print("Cannot read file {}", *input);
+                return 1;
+            }
+
+            auto sink = makeSink(*output, *result.find<std::string>("--compress"));
+            if (!sink)
+            {
+                fmt::print("Cannot open file {}", *output);
+                return 2;
+            }
+
+            Trace trace(format);
+            std::vector<u8> buffer(kChunkSize);
+            std::string text;
+            while (std::size_t length = source->read(buffer.data(), buffer.size()))
+            {
+                text.clear();
+                trace.render(text, buffer.data(), length);
+                if (!sink->write(std::move(text)))
+                {
+                    fmt::print("Cannot write file {}", *output);
+                    return 2;
+                }
+            }
+
+            if (source->isBad())
+            {
+                fmt::print("Cannot read file {}", *input);
+                return 1;
+            }
+
+            if (!sink->finish())
+            {
+                fmt::print("Cannot write file {}", *output);
+                return 2;
+            }
+
+            if (!trace.finish())
+            {
+                fmt::print("Incomplete trace record at the end of {}", *input);
+                return 1;
+            }
+            return 0;
+        }
+
+        std::optional<Annotations> annotations;
+        if (const auto database = result.find<fs::path>("--annotations"))
+        {
+            annotations.emplace(*database);
+            if (!annotations->isOpen())
+            {
+                fmt::print("Cannot read file {}", *database);
+                return 1;
+            }
+        }
+
+        if (*result.find<bool>("--pipeline"))
+        {
+            return pipeline(*input, *output, format, *result.find<std::string>("--decompress"), *result.find<std::string>("--compress"), addr, size == 2, annotations ? &*annotations : nullptr);
+        }
+
+        std::unique_ptr<Profile> profile;
+        if (*result.find<bool>("--profile"))
+            profile = std::make_unique<Profile>();
+
+        auto source = makeSource(*input, *result.find<std::string>("--decompress"));
+        if (!source)
+        {
+            fmt::print("Cannot read file {}", *input);
             return 1;
         }
 
-        data.resize(data.size() + data.size() % size, 0);
+        // Everything except the plain listing needs the whole input
+        bool whole = *result.find<uint>("--data")
+            || !result.find<std::string>("--cycles")->empty()
+            || *result.find<bool>("--parallel")
+            || *result.find<bool>("--functions")
+            || !result.find<std::string>("--cfg")->empty();
 
-        std::ofstream stream(output, std::ios::binary);
-        if (!stream || !stream.is_open())
+        std::vector<u8> data;
+        if (whole)
         {
-            fmt::print("Cannot open file {}", output);
+            Profile::Timer timer(profile.get(), Profile::kPhaseLoad);
+            data = readAll(*source);
+            if (source->isBad())
+            {
+                fmt::print("Cannot read file {}", *input);
+                return 1;
+            }
+        }
+
+        std::optional<DataMap> map;
+        if (const auto threshold = *result.find<uint>("--data"))
+            map.emplace(data.data(), data.size(), addr, size == 2, threshold);
+
+        if (*result.find<bool>("--parallel"))
+        {
+            data.resize(data.size() + data.size() % size, 0);
+
+            ListingHooks hooks;
+            hooks.data        = map ? &*map : nullptr;
+            hooks.annotations = annotations ? &*annotations : nullptr;
+
+            return writeParallel(*output, format, data, addr, size == 2, hooks);
+        }
+
+        auto sink = makeSink(*output, *result.find<std::string>("--compress"));
+        if (!sink)
+        {
+            fmt::print("Cannot open file {}", *output);
             return 2;
         }
 
-        if (size == 4)
+        if (const auto graph = *result.find<std::string>("--cfg"); !graph.empty())
+        {
+            if (graph != "dot" && graph != "edges")
+                throw std::runtime_error("Unknown graph format " + graph);
+
+            data.resize(data.size() + data.size() % size, 0);
+
+            Cfg cfg(data.data(), data.size(), addr, size == 2);
+
+            std::string text;
+            if (graph == "dot")
+                cfg.writeDot(text);
+            else
+                cfg.writeEdges(text);
+
+            if (!sink->write(std::move(text)) || !sink->finish())
+            {
+                fmt::print("Cannot write file {}", *output);
+                return 2;
+            }
+            return 0;
+        }
+
+        if (*result.find<bool>("--functions"))
         {
-            for (u32 instr : PointerRange(reinterpret_cast<u32*>(data.data()), data.size() / 4))
+            data.resize(data.size() + data.size() % size, 0);
+
+            for (auto& block : listFunctions(format, data.data(), data.size(), addr, size == 2))
+            {
+                if (!sink->write(std::move(block)))
+                {
+                    fmt::print("Cannot write file {}", *output);
+                    return 2;
+                }
+            }
+
+            if (!sink->finish())
             {
-                stream << fmt::format(
-                    format,
-                    fmt::arg("addr", addr),
-                    fmt::arg("instr", instr),
-                    fmt::arg("mnemonic", disassemble(instr, addr + 8)));
+                fmt::print("Cannot write file {}", *output);
+                return 2;
+            }
+            return 0;
+        }
+
+        std::optional<Cfg> graph;
+        std::optional<CycleCounter> cycles;
+        if (const auto region = *result.find<std::string>("--cycles"); !region.empty())
+        {
+            Waitstates waitstates;
+            if (!Waitstates::parse(region, waitstates))
+                throw std::runtime_error("Unknown region " + region);
+
+            // Blocks also end before branch targets, which needs the whole input
+            graph.emplace(data.data(), data.size(), addr, size == 2);
+            cycles.emplace(waitstates, &*graph);
+        }
 
-                stream << kLineBreak;
+        std::optional<Index> index;
+        if (const auto interval = *result.find<uint>("--index"))
+        {
+            fs::path path = *output;
+            path += ".idx";
 
-                addr += 4;
+            index.emplace(path, interval);
+            if (!index->isOpen())
+            {
+                fmt::print("Cannot open file {}", path);
+                return 2;
             }
         }
-        else
+
+        ListingHooks hooks;
+        hooks.cycles      = cycles ? &*cycles : nullptr;
+        hooks.profile     = profile.get();
+        hooks.index       = index ? &*index : nullptr;
+        hooks.data        = map ? &*map : nullptr;
+        hooks.annotations = annotations ? &*annotations : nullptr;
+
+        // Streams the input unless it has been read as a whole
+        std::vector<u8> buffer(whole ? 0 : kChunkSize);
+        std::size_t offset = 0;
+        auto next = [&]() -> std::pair<const u8*, std::size_t>
+        {
+            if (whole)
+            {
+                std::size_t length = std::min(kChunkSize, data.size() - offset);
+                offset += length;
+                return { data.data() + offset - length, length };
+            }
+
+            Profile::Timer timer(profile.get(), Profile::kPhaseLoad);
+            return { buffer.data(), source->read(buffer.data(), buffer.size()) };
+        };
+
+        DisasmContext context(addr, size == 2);
+        std::string text;
+        while (true)
         {
-            u32 lr = 0;
+            auto [chunk, length] = next();
+            if (profile)
+                profile->read(length);
 
-            for (u16 instr : PointerRange(reinterpret_cast<u16*>(data.data()), data.size() / 2))
+            text.clear();
+            if (length > 0)
+                context.feed(text, format, chunk, length, hooks);
+            else
+                context.finish(text, format, hooks);
+            if (index)
+                index->advance(text.size());
+
+            Profile::Timer timer(profile.get(), Profile::kPhaseWrite);
+            if (!sink->write(std::move(text)))
             {
-                stream << fmt::format(
-                    format,
-                    fmt::arg("addr", addr),
-                    fmt::arg("instr", instr),
-                    fmt::arg("mnemonic", disassemble(instr, addr + 4, lr)));
+                fmt::print("Cannot write file {}", *output);
+                return 2;
+            }
 
-                stream << kLineBreak;
+            if (length == 0)
+                break;
+        }
+
+        if (source->isBad())
+        {
+            fmt::print("Cannot read file {}", *input);
+            return 1;
+        }
 
-                uint offset = shell::bit::seq<0, 11>(instr);
-                offset = shell::bit::signEx<11>(offset);
-                offset <<= 12;
-                lr = addr + 4 + offset;
+        if (index && !index->finish())
+        {
+            fmt::print("Cannot write file {}.idx", *output);
+            return 2;
+        }
 
-                addr += 2;
+        if (cycles)
+        {
+            text.clear();
+            cycles->finish(text);
+            if (!sink->write(std::move(text)))
+            {
+                fmt::print("Cannot write file {}", *output);
+                return 2;
             }
         }
+
+        {
+            Profile::Timer timer(profile.get(), Profile::kPhaseWrite);
+            if (!sink->finish())
+            {
+                fmt::print("Cannot write file {}", *output);
+                return 2;
+            }
+        }
+
+        if (profile)
+            profile->print();
+
         return 0;
     }
     catch (const std::exception& ex)
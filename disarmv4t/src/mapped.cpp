@@ -0,0 +1,72 @@
+#include "mapped.h"
+
+#ifndef _WIN32
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace fs = shell::filesystem;
+
+MappedFile::MappedFile(const fs::path& path)
+{
+#ifndef _WIN32
+    int fd = ::open(path.string().c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+
+    struct stat status;
+    if (::fstat(fd, &status) == 0)
+    {
+        open = true;
+        if (status.st_size > 0)
+        {
+            void* view = ::mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (view != MAP_FAILED)
+            {
+                address = static_cast<const u8*>(view);
+                length = static_cast<std::size_t>(status.st_size);
+                mapped = true;
+            }
+            else
+            {
+                open = false;
+            }
+        }
+    }
+    ::close(fd);
+#else
+    auto [status, content] = fs::read<std::vector<u8>>(path);
+    if (status != fs::Status::Ok)
+        return;
+
+    buffer = std::move(content);
+    address = buffer.data();
+    length = buffer.size();
+    open = true;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifndef _WIN32
+    if (mapped)
+        ::munmap(const_cast<u8*>(address), length);
+#endif
+}
+
+bool MappedFile::isOpen() const
+{
+    return open;
+}
+
+const u8* MappedFile::data() const
+{
+    return address;
+}
+
+std::size_t MappedFile::size() const
+{
+    return length;
+}
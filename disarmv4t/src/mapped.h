@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vector>
+
+#include <shell/filesystem.h>
+
+#include "int.h"
+
+// Read-only view of a file. It is memory-mapped where possible and read
+// into a buffer otherwise.
+class MappedFile
+{
+public:
+    explicit MappedFile(const shell::filesystem::path& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const;
+    const u8* data() const;
+    std::size_t size() const;
+
+private:
+    const u8* address = nullptr;
+    std::size_t length = 0;
+    bool open = false;
+    bool mapped = false;
+    std::vector<u8> buffer;
+};
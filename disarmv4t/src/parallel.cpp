@@ -0,0 +1,165 @@
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include <shell/fmt.h>
+
+#include "branch.h"
+#include "listing.h"
+#include "pool.h"
+
+#ifndef _WIN32
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+namespace fs = shell::filesystem;
+
+#ifndef _WIN32
+
+static constexpr std::size_t kChunkSize = 256 * 1024;
+
+static bool reserve(int fd, u64 offset, u64 size)
+{
+#ifdef __linux__
+    if (::fallocate(fd, 0, offset, size) == 0)
+        return true;
+#endif
+    return ::ftruncate(fd, offset + size) == 0;
+}
+
+static bool writeAll(int fd, const std::string& block, u64 offset)
+{
+    std::size_t written = 0;
+    while (written < block.size())
+    {
+        ssize_t count = ::pwrite(fd, block.data() + written, block.size() - written, offset + written);
+        if (count < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+
+        if (count == 0)
+            return false;
+
+        written += count;
+    }
+    return true;
+}
+
+// Closes the descriptor if a task rethrows from wait. It is declared before
+// the pool, so running writes are joined before the descriptor is closed.
+struct Descriptor
+{
+    ~Descriptor()
+    {
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+    bool close()
+    {
+        int result = ::close(fd);
+        fd = -1;
+        return result == 0;
+    }
+
+    int fd;
+};
+
+// Renders rounds of chunks into separate buffers. Their lengths give the
+// file offsets, so each buffer is written with its own pwrite without
+// waiting for the others.
+int writeParallel(const fs::path& output, const Format& format, const std::vector<u8>& data, u32 addr, bool thumb, const ListingHooks& hooks)
+{
+    Descriptor file = { ::open(output.string().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644) };
+    if (file.fd < 0)
+    {
+        fmt::print("Cannot open file {}", output);
+        return 2;
+    }
+
+    const int fd = file.fd;
+
+    ThreadPool pool;
+    std::vector<std::string> blocks(4 * pool.size());
+    std::vector<u64> offsets(blocks.size());
+    std::atomic<bool> failed = false;
+
+    u64 base = 0;
+    for (std::size_t begin = 0; begin < data.size() && !failed; begin += blocks.size() * kChunkSize)
+    {
+        std::size_t count = std::min(blocks.size(), (data.size() - begin + kChunkSize - 1) / kChunkSize);
+
+        for (std::size_t x = 0; x < count; ++x)
+        {
+            pool.submit([&, x]()
+            {
+                std::size_t offset = begin + x * kChunkSize;
+                std::size_t length = std::min(kChunkSize, data.size() - offset);
+                u32 pc = addr + static_cast<u32>(offset);
+
+                // The lr only depends on the previous halfword
+                u32 lr = 0;
+                if (thumb && offset > 0)
+                {
+                    u16 prev;
+                    std::memcpy(&prev, data.data() + offset - 2, sizeof(prev));
+                    lr = thumbLongBranchSetup(prev, pc + 2);
+                }
+
+                blocks[x].clear();
+                listing(blocks[x], format, data.data() + offset, length, pc, thumb, lr, hooks);
+            });
+        }
+        pool.wait();
+
+        u64 size = 0;
+        for (std::size_t x = 0; x < count; ++x)
+        {
+            offsets[x] = base + size;
+            size += blocks[x].size();
+        }
+
+        if (!reserve(fd, base, size))
+        {
+            failed = true;
+            break;
+        }
+
+        for (std::size_t x = 0; x < count; ++x)
+        {
+            pool.submit([&, x]()
+            {
+                if (!writeAll(fd, blocks[x], offsets[x]))
+                    failed = true;
+            });
+        }
+        pool.wait();
+
+        base += size;
+    }
+
+    if (!file.close() || failed)
+    {
+        fmt::print("Cannot write file {}", output);
+        return 2;
+    }
+    return 0;
+}
+
+#else
+
+int writeParallel(const fs::path& output, const Format& format, const std::vector<u8>& data, u32 addr, bool thumb, const ListingHooks& hooks)
+{
+    fmt::print("Parallel writing is not supported on this platform");
+    return 6;
+}
+
+#endif
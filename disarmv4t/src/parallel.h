@@ -0,0 +1,12 @@
+#pragma once
+
+#include <vector>
+
+#include <shell/filesystem.h>
+
+#include "format.h"
+#include "int.h"
+#include "listing.h"
+
+// The hooks are shared by all workers and must not have state like cycles or an index
+int writeParallel(const shell::filesystem::path& output, const Format& format, const std::vector<u8>& data, u32 addr, bool thumb, const ListingHooks& hooks);
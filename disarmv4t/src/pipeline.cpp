@@ -0,0 +1,168 @@
+#include "pipeline.h"
+
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+
+#include <shell/fmt.h>
+
+#include "context.h"
+#include "ring.h"
+#include "sink.h"
+#include "source.h"
+
+namespace fs = shell::filesystem;
+
+static constexpr std::size_t kChunkSize = 256 * 1024;
+static constexpr std::size_t kSlots = 4;
+
+struct Block
+{
+    std::vector<u8> data;
+    std::size_t size = 0;
+    bool last = false;
+    bool bad = false;
+};
+
+struct Text
+{
+    std::string text;
+    bool last = false;
+};
+
+// Reads, disassembles and writes on three threads connected by rings, so
+// reading and writing overlap decoding and memory stays bounded.
+int pipeline(const fs::path& input, const fs::path& output, const Format& format, const std::string& decompression, const std::string& compression, u32 addr, bool thumb, const Annotations* annotations)
+{
+    auto source = makeSource(input, decompression);
+    if (!source)
+    {
+        fmt::print("Cannot read file {}", input);
+        return 1;
+    }
+
+    auto sink = makeSink(output, compression);
+    if (!sink)
+    {
+        fmt::print("Cannot open file {}", output);
+        return 2;
+    }
+
+    Ring<Block, kSlots> blocks;
+    Ring<Text, kSlots> texts;
+    std::atomic<bool> failed = false;
+
+    // The first exception of any stage closes both rings, so the other
+    // stages stop waiting and every thread can be joined before rethrowing
+    std::exception_ptr errors[3];
+    auto stop = [&](std::exception_ptr& error)
+    {
+        error = std::current_exception();
+        blocks.close();
+        texts.close();
+    };
+
+    std::thread reader([&]()
+    {
+        try
+        {
+            while (Block* block = blocks.back())
+            {
+                block->data.resize(kChunkSize);
+
+                block->size = source->read(block->data.data(), block->data.size());
+                block->last = block->size < block->data.size();
+                block->bad  = block->last && source->isBad();
+
+                bool last = block->last;
+                blocks.push();
+                if (last)
+                    return;
+            }
+        }
+        catch (...)
+        {
+            stop(errors[0]);
+        }
+    });
+
+    std::thread writer([&]()
+    {
+        try
+        {
+            while (Text* text = texts.front())
+            {
+                bool last = text->last;
+                if (!failed && !sink->writeView(text->text))
+                    failed = true;
+
+                texts.pop();
+                if (last)
+                    return;
+            }
+        }
+        catch (...)
+        {
+            stop(errors[1]);
+        }
+    });
+
+    ListingHooks hooks;
+    hooks.annotations = annotations;
+
+    DisasmContext context(addr, thumb);
+    bool bad = false;
+    try
+    {
+        while (true)
+        {
+            Block* block = blocks.front();
+            Text* text = block ? texts.back() : nullptr;
+            if (!text)
+                break;
+
+            text->text.clear();
+            if (!failed)
+                context.feed(text->text, format, block->data.data(), block->size, hooks);
+
+            text->last = block->last;
+            bad = block->bad;
+            blocks.pop();
+
+            bool last = text->last;
+            if (last && !failed)
+                context.finish(text->text, format, hooks);
+
+            texts.push();
+            if (last)
+                break;
+        }
+    }
+    catch (...)
+    {
+        stop(errors[2]);
+    }
+
+    reader.join();
+    writer.join();
+
+    for (const auto& error : errors)
+    {
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    if (bad)
+    {
+        fmt::print("Cannot read file {}", input);
+        return 1;
+    }
+
+    if (failed || !sink->finish())
+    {
+        fmt::print("Cannot write file {}", output);
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <string>
+
+#include <shell/filesystem.h>
+
+#include "annotations.h"
+#include "format.h"
+#include "int.h"
+
+int pipeline(const shell::filesystem::path& input, const shell::filesystem::path& output, const Format& format, const std::string& decompression, const std::string& compression, u32 addr, bool thumb, const Annotations* annotations);
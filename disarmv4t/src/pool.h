@@ -0,0 +1,172 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "int.h"
+
+// Work-stealing pool. Every worker owns a queue, pops its newest task and
+// steals the oldest task of another worker when its own queue is empty.
+class ThreadPool
+{
+public:
+    using Task = std::function<void()>;
+
+    explicit ThreadPool(uint threads = std::thread::hardware_concurrency())
+    {
+        threads = std::max<uint>(threads, 1);
+        for (uint x = 0; x < threads; ++x)
+            queues.push_back(std::make_unique<Queue>());
+
+        for (uint x = 0; x < threads; ++x)
+            workers.emplace_back([this, x]() { run(x); });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard lock(mutex);
+            stopped = true;
+        }
+        condition.notify_all();
+
+        for (auto& worker : workers)
+            worker.join();
+    }
+
+    void submit(Task task)
+    {
+        // Tasks submitted by a worker stay local, others are distributed
+        uint index = current.pool == this
+            ? current.index
+            : next++ % size();
+
+        {
+            // Sleeping workers check queued under the pool mutex, so holding
+            // it here cannot lose the wakeup
+            std::lock_guard lock(mutex);
+            unfinished++;
+
+            Queue& queue = *queues[index];
+            std::lock_guard queueLock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+            queued++;
+        }
+        condition.notify_one();
+    }
+
+    // Waits for all tasks and rethrows the first exception one of them threw
+    void wait()
+    {
+        std::unique_lock lock(mutex);
+        idle.wait(lock, [this]() { return unfinished == 0; });
+
+        if (error)
+            std::rethrow_exception(std::exchange(error, nullptr));
+    }
+
+    uint size() const
+    {
+        return static_cast<uint>(queues.size());
+    }
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    struct Current
+    {
+        ThreadPool* pool;
+        uint index;
+    };
+
+    bool pop(uint index, Task& task)
+    {
+        Queue& queue = *queues[index];
+        std::lock_guard lock(queue.mutex);
+        if (queue.tasks.empty())
+            return false;
+
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        queued--;
+        return true;
+    }
+
+    bool steal(uint index, Task& task)
+    {
+        for (uint x = 1; x < size(); ++x)
+        {
+            Queue& queue = *queues[(index + x) % size()];
+            std::lock_guard lock(queue.mutex);
+            if (queue.tasks.empty())
+                continue;
+
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            queued--;
+            return true;
+        }
+        return false;
+    }
+
+    void run(uint index)
+    {
+        current = { this, index };
+
+        while (true)
+        {
+            Task task;
+            if (pop(index, task) || steal(index, task))
+            {
+                std::exception_ptr exception;
+                try
+                {
+                    task();
+                }
+                catch (...)
+                {
+                    exception = std::current_exception();
+                }
+
+                std::lock_guard lock(mutex);
+                if (exception && !error)
+                    error = exception;
+                if (--unfinished == 0)
+                    idle.notify_all();
+                continue;
+            }
+
+            std::unique_lock lock(mutex);
+            condition.wait(lock, [this]() { return stopped || queued > 0; });
+
+            if (stopped && queued == 0)
+                return;
+        }
+    }
+
+    static inline thread_local Current current;
+
+    bool stopped = false;
+    std::atomic<uint> queued = 0;
+    std::atomic<uint> next = 0;
+    std::size_t unfinished = 0;
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::condition_variable idle;
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+};
@@ -0,0 +1,62 @@
+#include "profile.h"
+
+#include <shell/fmt.h>
+
+#ifdef _WIN32
+#  include <windows.h>
+#  include <psapi.h>
+#else
+#  include <sys/resource.h>
+#endif
+
+static u64 peakRss()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize;
+    return 0;
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#  ifdef __APPLE__
+    return usage.ru_maxrss;
+#  else
+    return static_cast<u64>(usage.ru_maxrss) * 1024;
+#  endif
+#endif
+}
+
+Profile::Profile()
+    : begin(Clock::now()) {}
+
+void Profile::count(u64 instructions)
+{
+    this->instructions += instructions;
+}
+
+void Profile::read(u64 bytes)
+{
+    this->bytes += bytes;
+}
+
+void Profile::print() const
+{
+    using Seconds = std::chrono::duration<double>;
+
+    static constexpr const char* kPhases[kPhaseCount] = {
+        "load", "decode", "render", "write"
+    };
+
+    double total = Seconds(Clock::now() - begin).count();
+    double work  = Seconds(phases[kPhaseDecode] + phases[kPhaseRender]).count();
+
+    for (uint phase = 0; phase < kPhaseCount; ++phase)
+        fmt::print("{:<14}{:>10.3f} ms\n", kPhases[phase], 1000 * Seconds(phases[phase]).count());
+
+    fmt::print("{:<14}{:>10.3f} ms\n", "total", 1000 * total);
+    fmt::print("{:<14}{:>10} ({:.1f} M/s)\n", "instructions", instructions, work > 0 ? instructions / work / 1e6 : 0.0);
+    fmt::print("{:<14}{:>10} ({:.1f} MB/s)\n", "bytes", bytes, total > 0 ? bytes / total / 1e6 : 0.0);
+    fmt::print("{:<14}{:>10.1f} MB\n", "peak rss", peakRss() / 1e6);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+
+#include "int.h"
+
+// Phase timers for --profile. Timers without a profile do not read the clock.
+class Profile
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum Phase
+    {
+        kPhaseLoad,
+        kPhaseDecode,
+        kPhaseRender,
+        kPhaseWrite,
+        kPhaseCount
+    };
+
+    class Timer
+    {
+    public:
+        Timer(Profile* profile, Phase phase)
+            : profile(profile), phase(phase)
+        {
+            if (profile)
+                begin = Clock::now();
+        }
+
+        ~Timer()
+        {
+            if (profile)
+                profile->phases[phase] += Clock::now() - begin;
+        }
+
+    private:
+        Profile* profile;
+        Phase phase;
+        Clock::time_point begin;
+    };
+
+    Profile();
+
+    void count(u64 instructions);
+    void read(u64 bytes);
+    void print() const;
+
+private:
+    Clock::time_point begin;
+    std::array<Clock::duration, kPhaseCount> phases = {};
+    u64 instructions = 0;
+    u64 bytes = 0;
+};
@@ -0,0 +1,212 @@
+#include "regions.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <shell/constants.h>
+#include <shell/fmt.h>
+
+#include "branch.h"
+#include "int.h"
+#include "listing.h"
+#include "mapped.h"
+#include "pool.h"
+#include "sink.h"
+
+namespace fs = shell::filesystem;
+
+// Region maps are lines of whitespace separated fields:
+//   <offset> <length> <base> <arm|thumb>
+// A length of 0 extends the region to the end of the input. Empty lines,
+// lines starting with # and regions without bytes are ignored.
+
+struct Region
+{
+    u64 offset = 0;
+    u64 length = 0;
+    u32 addr = 0;
+    bool thumb = false;
+};
+
+struct Chunk
+{
+    const Region* region;
+    u64 begin;
+    u64 length;
+};
+
+static constexpr u64 kChunkSize = 256 * 1024;
+
+static bool parseNumber(const std::string& text, u64& value)
+{
+    std::size_t used = 0;
+    try
+    {
+        value = std::stoull(text, &used, 0);
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+    return used == text.size() && text[0] != '-';
+}
+
+static std::vector<Region> parseRegions(const fs::path& map, u64 size)
+{
+    std::ifstream stream(map);
+    if (!stream || !stream.is_open())
+        throw std::runtime_error(fmt::format("Cannot read region map {}", map));
+
+    std::vector<Region> regions;
+
+    std::string line;
+    for (uint number = 1; std::getline(stream, line); ++number)
+    {
+        std::istringstream fields(line);
+
+        std::string offset;
+        std::string length;
+        std::string base;
+        std::string mode;
+        if (!(fields >> offset) || offset[0] == '#')
+            continue;
+
+        if (!(fields >> length >> base >> mode) || (mode != "arm" && mode != "thumb"))
+            throw std::runtime_error(fmt::format("Bad region line {}", number));
+
+        Region region;
+        u64 addr = 0;
+        if (!parseNumber(offset, region.offset) || !parseNumber(length, region.length) || !parseNumber(base, addr) || addr > 0xFFFFFFFF)
+            throw std::runtime_error(fmt::format("Bad number in region line {}", number));
+
+        region.addr  = static_cast<u32>(addr);
+        region.thumb = mode == "thumb";
+
+        if (region.offset > size || region.length > size - region.offset)
+            throw std::runtime_error(fmt::format("Region line {} exceeds the input", number));
+
+        if (region.length == 0)
+            region.length = size - region.offset;
+
+        // A region starting at the end of the input has nothing to list
+        if (region.length == 0)
+            continue;
+
+        regions.push_back(region);
+    }
+    return regions;
+}
+
+static void render(std::string& text, const Format& format, const u8* data, const Chunk& chunk)
+{
+    const Region& region = *chunk.region;
+    const u8* begin = data + region.offset + chunk.begin;
+    const u64 width = region.thumb ? 2 : 4;
+    const u32 pc    = region.addr + static_cast<u32>(chunk.begin);
+
+    if (chunk.begin == 0)
+    {
+        fmt::format_to(std::back_inserter(text), "; region {:08X}-{:08X} {}",
+            region.addr, region.addr + static_cast<u32>(region.length - 1), region.thumb ? "thumb" : "arm");
+        text.append(shell::kLineBreak);
+    }
+
+    // The lr only depends on the previous halfword
+    u32 lr = 0;
+    if (region.thumb && chunk.begin > 0)
+    {
+        u16 prev;
+        std::memcpy(&prev, begin - 2, sizeof(prev));
+        lr = thumbLongBranchSetup(prev, pc + 2);
+    }
+
+    u64 whole = chunk.length - chunk.length % width;
+    listing(text, format, begin, whole, pc, region.thumb, lr);
+
+    if (chunk.begin + chunk.length == region.length)
+    {
+        // An incomplete instruction is padded with zeros like a short input file
+        u64 tail = chunk.length - whole;
+        if (tail + tail % width >= width)
+        {
+            u8 padded[4] = {};
+            std::memcpy(padded, begin + whole, tail);
+            listing(text, format, padded, width, pc + static_cast<u32>(whole), region.thumb, lr);
+        }
+        text.append(shell::kLineBreak);
+    }
+}
+
+// Splits all regions into chunks, renders rounds of them concurrently and
+// writes each round in address order.
+int regions(const fs::path& map, const fs::path& input, const fs::path& output, const Format& format, const std::string& compression)
+{
+    MappedFile file(input);
+    if (!file.isOpen())
+    {
+        fmt::print("Cannot read file {}", input);
+        return 1;
+    }
+
+    auto regions = parseRegions(map, file.size());
+    std::stable_sort(regions.begin(), regions.end(), [](const Region& a, const Region& b)
+    {
+        return a.addr < b.addr;
+    });
+
+    std::vector<Chunk> chunks;
+    for (const auto& region : regions)
+    {
+        u64 begin = 0;
+        do
+        {
+            u64 length = std::min(kChunkSize, region.length - begin);
+            chunks.push_back({ &region, begin, length });
+            begin += length;
+        }
+        while (begin < region.length);
+    }
+
+    auto sink = makeSink(output, compression);
+    if (!sink)
+    {
+        fmt::print("Cannot open file {}", output);
+        return 2;
+    }
+
+    ThreadPool pool;
+    std::vector<std::string> blocks(4 * pool.size());
+    for (std::size_t begin = 0; begin < chunks.size(); begin += blocks.size())
+    {
+        std::size_t count = std::min(blocks.size(), chunks.size() - begin);
+        for (std::size_t x = 0; x < count; ++x)
+        {
+            pool.submit([&, x]()
+            {
+                blocks[x].clear();
+                render(blocks[x], format, file.data(), chunks[begin + x]);
+            });
+        }
+        pool.wait();
+
+        for (std::size_t x = 0; x < count; ++x)
+        {
+            if (!sink->write(std::move(blocks[x])))
+            {
+                fmt::print("Cannot write file {}", output);
+                return 2;
+            }
+        }
+    }
+
+    if (!sink->finish())
+    {
+        fmt::print("Cannot write file {}", output);
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <string>
+
+#include <shell/filesystem.h>
+
+#include "format.h"
+
+int regions(const shell::filesystem::path& map, const shell::filesystem::path& input, const shell::filesystem::path& output, const Format& format, const std::string& compression);
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "int.h"
+
+// Bounded single producer, single consumer ring. The producer fills back()
+// and publishes it with push(), the consumer reads front() and releases it
+// with pop(). Slots are reused, so their buffers keep their capacity.
+//
+// push() and pop() are a single atomic store and never lock. A waiting side
+// spins for a few tries and then parks on the condition variable, the mutex
+// is only taken to park and to wake a parked side. close() wakes both sides,
+// after which back() and front() return nullptr.
+template<typename T, std::size_t kSize>
+class Ring
+{
+public:
+    T* back()
+    {
+        std::size_t index = head.load(std::memory_order_relaxed);
+        if (!wait([&]() { return index - tail.load() != kSize; }))
+            return nullptr;
+
+        return &slots[index % kSize];
+    }
+
+    void push()
+    {
+        head.store(head.load(std::memory_order_relaxed) + 1);
+        wake();
+    }
+
+    T* front()
+    {
+        std::size_t index = tail.load(std::memory_order_relaxed);
+        if (!wait([&]() { return head.load() != index; }))
+            return nullptr;
+
+        return &slots[index % kSize];
+    }
+
+    void pop()
+    {
+        tail.store(tail.load(std::memory_order_relaxed) + 1);
+        wake();
+    }
+
+    void close()
+    {
+        {
+            std::lock_guard lock(mutex);
+            closed = true;
+        }
+        condition.notify_all();
+    }
+
+private:
+    static constexpr uint kSpins = 64;
+
+    template<typename Ready>
+    bool wait(Ready ready)
+    {
+        for (uint x = 0; x < kSpins; ++x)
+        {
+            if (closed)
+                return false;
+            if (ready())
+                return true;
+
+            std::this_thread::yield();
+        }
+
+        // The sleeper count and the indices are sequentially consistent, so
+        // either the other side sees the sleeper or the sleeper sees its update
+        std::unique_lock lock(mutex);
+        sleepers++;
+        condition.wait(lock, [&]() { return closed || ready(); });
+        sleepers--;
+
+        return !closed;
+    }
+
+    void wake()
+    {
+        if (sleepers == 0)
+            return;
+
+        {
+            std::lock_guard lock(mutex);
+        }
+        condition.notify_all();
+    }
+
+    std::array<T, kSize> slots;
+    alignas(64) std::atomic<std::size_t> head = 0;
+    alignas(64) std::atomic<std::size_t> tail = 0;
+    alignas(64) std::atomic<uint> sleepers = 0;
+    std::atomic<bool> closed = false;
+    std::mutex mutex;
+    std::condition_variable condition;
+};
@@ -0,0 +1,586 @@
+#include "server.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <list>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <shell/fmt.h>
+
+#include "int.h"
+#include "listing.h"
+
+#ifndef _WIN32
+#  include <fcntl.h>
+#  include <poll.h>
+#  include <signal.h>
+#  include <sys/socket.h>
+#  include <sys/stat.h>
+#  include <sys/time.h>
+#  include <sys/un.h>
+#  include <unistd.h>
+#endif
+
+namespace fs = shell::filesystem;
+
+// Requests are lines of whitespace separated fields:
+//   <text|fields> <arm|thumb> <base> hex <bytes>
+//   <text|fields> <arm|thumb> <base> file <offset> <length> <path>
+// An empty line ends a batch. Each request is answered with "ok <lines>"
+// followed by its lines or "error <message>". The batch response is
+// terminated by an empty line.
+
+// Bounds the memory one client can make the daemon allocate. A request
+// decodes at most kMaxRange bytes and a batch response holds at most
+// kMaxResponse bytes, requests beyond either limit are answered with errors.
+static constexpr u64 kMaxRange = 1024 * 1024;
+static constexpr std::size_t kMaxResponse = 64 * 1024 * 1024;
+
+static uint parseNibble(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+
+    throw std::invalid_argument(fmt::format("bad hex digit {}", c));
+}
+
+static std::vector<u8> parseHex(const std::string& text)
+{
+    if (text.size() % 2)
+        throw std::invalid_argument("odd number of hex digits");
+
+    std::vector<u8> data;
+    data.reserve(text.size() / 2);
+
+    for (std::size_t x = 0; x < text.size(); x += 2)
+        data.push_back(static_cast<u8>(parseNibble(text[x]) << 4 | parseNibble(text[x + 1])));
+
+    return data;
+}
+
+static u64 parseNumber(const std::string& text, const char* name)
+{
+    std::size_t used = 0;
+    u64 value = 0;
+    try
+    {
+        value = std::stoull(text, &used, 0);
+    }
+    catch (const std::exception&)
+    {
+        used = 0;
+    }
+
+    if (text.empty() || used != text.size() || text[0] == '-')
+        throw std::invalid_argument(fmt::format("bad {} {}", name, text));
+
+    return value;
+}
+
+static std::vector<u8> readRange(const fs::path& path, u64 offset, u64 length)
+{
+    std::ifstream stream(path, std::ios::binary | std::ios::ate);
+    if (!stream || !stream.is_open())
+        throw std::invalid_argument(fmt::format("cannot read file {}", path));
+
+    const auto end = stream.tellg();
+    if (end < 0)
+        throw std::invalid_argument(fmt::format("cannot read file {}", path));
+
+    u64 size = static_cast<u64>(end);
+    if (offset > size)
+        throw std::invalid_argument("offset out of range");
+
+    if (length == 0 || length > size - offset)
+        length = size - offset;
+
+    if (length > kMaxRange)
+        throw std::invalid_argument(fmt::format("range longer than {} bytes", kMaxRange));
+
+    std::vector<u8> data(length);
+    stream.seekg(offset);
+    stream.read(reinterpret_cast<char*>(data.data()), length);
+
+    if (!stream || static_cast<u64>(stream.gcount()) != length)
+        throw std::invalid_argument(fmt::format("cannot read file {}", path));
+
+    return data;
+}
+
+static void request(const std::string& line, const Format& format, std::string& response)
+{
+    static const Format kFieldsFormat("{addr:08X}\t{instr:08X}\t{mnemonic}");
+
+    try
+    {
+        std::istringstream stream(line);
+
+        std::string kind;
+        std::string mode;
+        std::string base;
+        std::string source;
+        stream >> kind >> mode >> base >> source;
+
+        if (kind != "text" && kind != "fields")
+            throw std::invalid_argument("bad kind");
+        if (mode != "arm" && mode != "thumb")
+            throw std::invalid_argument("bad mode");
+
+        u64 addr = parseNumber(base, "base");
+        if (addr > 0xFFFFFFFF)
+            throw std::invalid_argument(fmt::format("bad base {}", base));
+
+        std::vector<u8> data;
+        if (source == "hex")
+        {
+            std::string bytes;
+            stream >> bytes;
+            if (bytes.size() / 2 > kMaxRange)
+                throw std::invalid_argument(fmt::format("range longer than {} bytes", kMaxRange));
+
+            data = parseHex(bytes);
+        }
+        else if (source == "file")
+        {
+            std::string offset;
+            std::string length;
+            std::string path;
+            stream >> offset >> length >> std::ws;
+            std::getline(stream, path);
+
+            data = readRange(path, parseNumber(offset, "offset"), parseNumber(length, "length"));
+        }
+        else
+        {
+            throw std::invalid_argument("bad source");
+        }
+
+        // Like the CLI, an incomplete last instruction is padded with zeros
+        const std::size_t width = mode == "thumb" ? 2 : 4;
+        data.resize((data.size() + width - 1) / width * width);
+
+        u32 lr = 0;
+        std::string text;
+        listing(
+            text,
+            kind == "text" ? format : kFieldsFormat,
+            data.data(),
+            data.size(),
+            static_cast<u32>(addr),
+            mode == "thumb",
+            lr);
+
+        if (response.size() + text.size() > kMaxResponse)
+            throw std::invalid_argument(fmt::format("response longer than {} bytes", kMaxResponse));
+
+        fmt::format_to(std::back_inserter(response), "ok {}\n", std::count(text.begin(), text.end(), '\n'));
+        response.append(text);
+    }
+    catch (const std::exception& ex)
+    {
+        fmt::format_to(std::back_inserter(response), "error {}\n", ex.what());
+    }
+}
+
+#ifndef _WIN32
+
+// A closed peer must fail the send instead of raising SIGPIPE. Platforms
+// without MSG_NOSIGNAL set SO_NOSIGPIPE on the socket instead.
+#ifdef MSG_NOSIGNAL
+static constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+static constexpr int kSendFlags = 0;
+#endif
+
+static bool sendAll(int fd, const std::string& data)
+{
+    std::size_t sent = 0;
+    while (sent < data.size())
+    {
+        ssize_t count = ::send(fd, data.data() + sent, data.size() - sent, kSendFlags);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            return false;
+
+        sent += count;
+    }
+    return true;
+}
+
+// A connection belongs to the poll loop while it waits for input and to one
+// worker while its input is answered. Descriptors are only closed by the poll
+// loop, so shutting down a busy connection cannot hit a reused descriptor.
+struct Connection
+{
+    int fd = -1;
+    bool busy = false;
+    bool closed = false;
+    std::string buffer;
+    std::string response;
+};
+
+static constexpr std::size_t kMaxLine = 16 * 1024 * 1024;
+static constexpr std::size_t kMaxClients = 64;
+static constexpr int kSendTimeout = 10;
+static constexpr int kBackoff = 100;
+
+// Answers the complete lines of one read, returns false once the connection
+// should be closed
+static bool receive(Connection& connection, const Format& format)
+{
+    char chunk[64 * 1024];
+    ssize_t count = ::recv(connection.fd, chunk, sizeof(chunk), 0);
+    if (count < 0)
+        return errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK;
+    if (count == 0)
+        return false;
+
+    auto& buffer = connection.buffer;
+    auto& response = connection.response;
+    buffer.append(chunk, count);
+
+    std::size_t begin = 0;
+    std::size_t end;
+    while ((end = buffer.find('\n', begin)) != std::string::npos)
+    {
+        std::string line = buffer.substr(begin, end - begin);
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        begin = end + 1;
+
+        if (line.empty())
+        {
+            response.push_back('\n');
+            if (!sendAll(connection.fd, response))
+                return false;
+            response.clear();
+        }
+        else
+        {
+            request(line, format, response);
+
+            // Only error lines can pass the limit, a client that keeps
+            // sending requests without ending the batch is dropped
+            if (response.size() > kMaxResponse)
+            {
+                response.append("error batch too long\n\n");
+                sendAll(connection.fd, response);
+                return false;
+            }
+        }
+    }
+    buffer.erase(0, begin);
+
+    // A client that never sends a newline cannot grow the buffer forever
+    if (buffer.size() > kMaxLine)
+    {
+        response.append("error line too long\n\n");
+        sendAll(connection.fd, response);
+        return false;
+    }
+    return true;
+}
+
+// SIGINT and SIGTERM write to this pipe, which wakes the poll loop
+static int interrupts[2] = { -1, -1 };
+
+static void interrupt(int)
+{
+    const int error = errno;
+    const char byte = 0;
+    [[maybe_unused]] ssize_t count = ::write(interrupts[1], &byte, 1);
+    errno = error;
+}
+
+static bool openPipe(int fds[2])
+{
+    if (::pipe(fds) < 0)
+        return false;
+
+    for (int x = 0; x < 2; ++x)
+    {
+        ::fcntl(fds[x], F_SETFL, ::fcntl(fds[x], F_GETFL) | O_NONBLOCK);
+        ::fcntl(fds[x], F_SETFD, FD_CLOEXEC);
+    }
+    return true;
+}
+
+static void drain(int fd)
+{
+    char bytes[64];
+    while (::read(fd, bytes, sizeof(bytes)) > 0);
+}
+
+// Errors of a single connection that was reset or aborted before it could be
+// accepted, the listening socket is still fine
+static bool isTransient(int error)
+{
+    return error == EINTR
+        || error == EAGAIN
+        || error == EWOULDBLOCK
+        || error == ECONNABORTED
+        || error == EPROTO
+        || error == EPERM;
+}
+
+// Running out of descriptors or memory passes once connections close
+static bool isExhausted(int error)
+{
+    return error == EMFILE
+        || error == ENFILE
+        || error == ENOBUFS
+        || error == ENOMEM;
+}
+
+int serve(const fs::path& socket, const Format& format)
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+
+    const auto path = socket.string();
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        fmt::print("Socket path too long {}", socket);
+        return 4;
+    }
+    path.copy(address.sun_path, path.size());
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        fmt::print("Cannot create socket {}", socket);
+        return 4;
+    }
+
+    // Only replace stale sockets, never regular files the path might name
+    struct stat status;
+    if (::lstat(path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode))
+        ::unlink(path.c_str());
+
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || ::listen(fd, SOMAXCONN) < 0)
+    {
+        fmt::print("Cannot bind socket {}", socket);
+        ::close(fd);
+        return 4;
+    }
+
+    // A client that resets between poll and accept must not block the loop
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    int wake[2];
+    if (!openPipe(interrupts) || !openPipe(wake))
+    {
+        fmt::print("Cannot create pipe for socket {}", socket);
+        for (int descriptor : { interrupts[0], interrupts[1] })
+        {
+            if (descriptor >= 0)
+                ::close(descriptor);
+        }
+        interrupts[0] = interrupts[1] = -1;
+        ::close(fd);
+        ::unlink(path.c_str());
+        return 4;
+    }
+
+    struct sigaction action = {};
+    action.sa_handler = interrupt;
+    sigemptyset(&action.sa_mask);
+
+    struct sigaction previous[2];
+    ::sigaction(SIGINT, &action, &previous[0]);
+    ::sigaction(SIGTERM, &action, &previous[1]);
+
+    // The poll loop waits for new clients and for input on idle connections,
+    // and hands readable connections to a fixed pool of workers. Idle clients
+    // therefore cost no thread. At most kMaxClients are connected at once,
+    // further clients wait in the listen backlog until a connection closes.
+    std::list<Connection> connections;
+    std::deque<Connection*> pending;
+    std::vector<Connection*> answered;
+    std::mutex mutex;
+    std::condition_variable ready;
+    bool stopping = false;
+
+    std::vector<std::thread> workers(std::max(std::thread::hardware_concurrency(), 1u));
+    for (auto& worker : workers)
+    {
+        worker = std::thread([&]()
+        {
+            while (true)
+            {
+                Connection* connection;
+                {
+                    std::unique_lock lock(mutex);
+                    ready.wait(lock, [&]() { return stopping || !pending.empty(); });
+                    if (stopping)
+                        return;
+
+                    connection = pending.front();
+                    pending.pop_front();
+                }
+
+                connection->closed = !receive(*connection, format);
+                {
+                    std::lock_guard lock(mutex);
+                    answered.push_back(connection);
+                }
+
+                const char byte = 0;
+                [[maybe_unused]] ssize_t count = ::write(wake[1], &byte, 1);
+            }
+        });
+    }
+
+    int result = 0;
+    bool exhausted = false;
+    std::vector<pollfd> fds;
+    std::vector<Connection*> polled;
+
+    while (true)
+    {
+        fds.clear();
+        polled.clear();
+        fds.push_back({ interrupts[0], POLLIN, 0 });
+        fds.push_back({ wake[0], POLLIN, 0 });
+        fds.push_back({ !exhausted && connections.size() < kMaxClients ? fd : -1, POLLIN, 0 });
+        for (auto& connection : connections)
+        {
+            if (!connection.busy)
+            {
+                fds.push_back({ connection.fd, POLLIN, 0 });
+                polled.push_back(&connection);
+            }
+        }
+
+        if (::poll(fds.data(), fds.size(), exhausted ? kBackoff : -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            fmt::print("Cannot poll socket {}", socket);
+            result = 4;
+            break;
+        }
+
+        if (fds[0].revents)
+            break;
+
+        exhausted = false;
+
+        for (std::size_t x = 0; x < polled.size(); ++x)
+        {
+            if (fds[3 + x].revents)
+            {
+                polled[x]->busy = true;
+                std::lock_guard lock(mutex);
+                pending.push_back(polled[x]);
+                ready.notify_one();
+            }
+        }
+
+        if (fds[1].revents)
+        {
+            drain(wake[0]);
+
+            std::lock_guard lock(mutex);
+            for (auto connection : answered)
+                connection->busy = false;
+            answered.clear();
+        }
+
+        connections.remove_if([](const Connection& connection)
+        {
+            if (connection.busy || !connection.closed)
+                return false;
+
+            ::close(connection.fd);
+            return true;
+        });
+
+        if (fds[2].revents)
+        {
+            int client = ::accept(fd, nullptr, nullptr);
+            if (client < 0)
+            {
+                if (isExhausted(errno))
+                {
+                    exhausted = true;
+                    continue;
+                }
+                if (isTransient(errno))
+                    continue;
+
+                fmt::print("Cannot accept on socket {}", socket);
+                result = 4;
+                break;
+            }
+
+            // Some platforms pass the non-blocking flag on to accepted sockets
+            ::fcntl(client, F_SETFL, ::fcntl(client, F_GETFL) & ~O_NONBLOCK);
+
+            // A client that stops reading only blocks its worker for a while
+            timeval timeout = {};
+            timeout.tv_sec = kSendTimeout;
+            ::setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+#ifdef SO_NOSIGPIPE
+            int enable = 1;
+            ::setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &enable, sizeof(enable));
+#endif
+
+            connections.emplace_back().fd = client;
+        }
+    }
+
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    ready.notify_all();
+
+    // Workers still answering a connection stop at their next send
+    for (auto& connection : connections)
+    {
+        if (connection.busy)
+            ::shutdown(connection.fd, SHUT_RDWR);
+    }
+
+    for (auto& worker : workers)
+        worker.join();
+
+    for (auto& connection : connections)
+        ::close(connection.fd);
+
+    ::sigaction(SIGINT, &previous[0], nullptr);
+    ::sigaction(SIGTERM, &previous[1], nullptr);
+
+    for (int descriptor : { interrupts[0], interrupts[1], wake[0], wake[1] })
+        ::close(descriptor);
+    interrupts[0] = interrupts[1] = -1;
+
+    ::close(fd);
+    ::unlink(path.c_str());
+    return result;
+}
+
+#else
+
+int serve(const fs::path& socket, const Format& format)
+{
+    fmt::print("Serving is not supported on this platform");
+    return 4;
+}
+
+#endif
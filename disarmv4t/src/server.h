@@ -0,0 +1,7 @@
+#pragma once
+
+#include <shell/filesystem.h>
+
+#include "format.h"
+
+int serve(const shell::filesystem::path& socket, const Format& format);
@@ -0,0 +1,384 @@
+#include "sink.h"
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "int.h"
+
+#ifdef DISARMV4T_ZLIB
+#  include <zlib.h>
+#endif
+
+#ifdef DISARMV4T_ZSTD
+#  include <zstd.h>
+#endif
+
+namespace fs = shell::filesystem;
+
+class FileSink : public Sink
+{
+public:
+    explicit FileSink(const fs::path& path)
+        : stream(path, std::ios::binary) {}
+
+    bool isOpen() const
+    {
+        return stream && stream.is_open();
+    }
+
+    bool write(std::string block) override
+    {
+        return writeView(block);
+    }
+
+    bool writeView(std::string_view block) override
+    {
+        return writeRaw(block.data(), block.size());
+    }
+
+    bool finish() override
+    {
+        stream.flush();
+        return static_cast<bool>(stream);
+    }
+
+protected:
+    bool writeRaw(const char* data, std::size_t size)
+    {
+        stream.write(data, size);
+        return static_cast<bool>(stream);
+    }
+
+private:
+    std::ofstream stream;
+};
+
+#ifdef DISARMV4T_ZLIB
+
+class GzipSink : public FileSink
+{
+public:
+    GzipSink(const fs::path& path, int level)
+        : FileSink(path)
+    {
+        if (deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            throw std::runtime_error("Cannot initialize gzip");
+    }
+
+    ~GzipSink() override
+    {
+        deflateEnd(&stream);
+    }
+
+    bool writeView(std::string_view block) override
+    {
+        return deflate(block.data(), block.size(), Z_NO_FLUSH);
+    }
+
+    bool finish() override
+    {
+        return deflate(nullptr, 0, Z_FINISH) && FileSink::finish();
+    }
+
+private:
+    bool deflate(const char* data, std::size_t size, int flush)
+    {
+        stream.next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        stream.avail_in = static_cast<uInt>(size);
+
+        int status;
+        do
+        {
+            stream.next_out  = output;
+            stream.avail_out = sizeof(output);
+
+            status = ::deflate(&stream, flush);
+            if (status == Z_STREAM_ERROR)
+                return false;
+
+            if (!writeRaw(reinterpret_cast<const char*>(output), sizeof(output) - stream.avail_out))
+                return false;
+        }
+        while (stream.avail_out == 0 || (flush == Z_FINISH && status != Z_STREAM_END));
+
+        return true;
+    }
+
+    z_stream stream = {};
+    Bytef output[64 * 1024];
+};
+
+#endif
+
+#ifdef DISARMV4T_ZSTD
+
+class ZstdSink : public FileSink
+{
+public:
+    ZstdSink(const fs::path& path, int level)
+        : FileSink(path), context(ZSTD_createCCtx())
+    {
+        if (!context)
+            throw std::runtime_error("Cannot initialize zstd");
+
+        ZSTD_CCtx_setParameter(context, ZSTD_c_compressionLevel, level);
+    }
+
+    ~ZstdSink() override
+    {
+        ZSTD_freeCCtx(context);
+    }
+
+    bool writeView(std::string_view block) override
+    {
+        return compress(block.data(), block.size(), ZSTD_e_continue);
+    }
+
+    bool finish() override
+    {
+        return compress(nullptr, 0, ZSTD_e_end) && FileSink::finish();
+    }
+
+private:
+    bool compress(const char* data, std::size_t size, ZSTD_EndDirective directive)
+    {
+        ZSTD_inBuffer input = { data, size, 0 };
+
+        while (true)
+        {
+            ZSTD_outBuffer output = { this->output, sizeof(this->output), 0 };
+
+            std::size_t remaining = ZSTD_compressStream2(context, &output, &input, directive);
+            if (ZSTD_isError(remaining))
+                return false;
+
+            if (!writeRaw(this->output, output.pos))
+                return false;
+
+            if (directive == ZSTD_e_end ? remaining == 0 : input.pos == input.size)
+                return true;
+        }
+    }
+
+    ZSTD_CCtx* context;
+    char output[64 * 1024];
+};
+
+#endif
+
+// Runs the wrapped sink on a separate thread so compression overlaps disassembly
+class ThreadedSink : public Sink
+{
+public:
+    static constexpr std::size_t kMaxBlocks = 8;
+
+    explicit ThreadedSink(std::unique_ptr<Sink> sink)
+        : sink(std::move(sink))
+    {
+        thread = std::thread([this]() { run(); });
+    }
+
+    ~ThreadedSink() override
+    {
+        stop();
+    }
+
+    bool write(std::string block) override
+    {
+        std::unique_lock lock(mutex);
+        condition.wait(lock, [this]() { return blocks.size() < kMaxBlocks || failed; });
+
+        if (failed)
+            return false;
+
+        blocks.push_back(std::move(block));
+        condition.notify_all();
+        return true;
+    }
+
+    bool writeView(std::string_view block) override
+    {
+        std::unique_lock lock(mutex);
+        condition.wait(lock, [this]() { return blocks.size() < kMaxBlocks || failed; });
+
+        if (failed)
+            return false;
+
+        std::string copy;
+        if (!spare.empty())
+        {
+            copy = std::move(spare.back());
+            spare.pop_back();
+        }
+        copy.assign(block);
+
+        blocks.push_back(std::move(copy));
+        condition.notify_all();
+        return true;
+    }
+
+    bool finish() override
+    {
+        stop();
+        return !failed && sink->finish();
+    }
+
+private:
+    void run()
+    {
+        while (true)
+        {
+            std::string block;
+            {
+                std::unique_lock lock(mutex);
+                condition.wait(lock, [this]() { return stopped || !blocks.empty(); });
+
+                if (blocks.empty())
+                    return;
+
+                block = std::move(blocks.front());
+                blocks.pop_front();
+                condition.notify_all();
+            }
+
+            if (!sink->writeView(block))
+            {
+                std::lock_guard lock(mutex);
+                failed = true;
+                condition.notify_all();
+                return;
+            }
+
+            // Written blocks are recycled for copies, so their capacity is
+            // only allocated once
+            std::lock_guard lock(mutex);
+            if (spare.size() < kMaxBlocks)
+            {
+                block.clear();
+                spare.push_back(std::move(block));
+            }
+        }
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard lock(mutex);
+            stopped = true;
+        }
+        condition.notify_all();
+
+        if (thread.joinable())
+            thread.join();
+    }
+
+    std::unique_ptr<Sink> sink;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<std::string> blocks;
+    std::vector<std::string> spare;
+    bool stopped = false;
+    bool failed = false;
+};
+
+#if defined(DISARMV4T_ZLIB) || defined(DISARMV4T_ZSTD)
+
+static int parseLevel(const std::string& text, int min, int max)
+{
+    std::size_t used = 0;
+    int level = 0;
+    try
+    {
+        level = std::stoi(text, &used, 10);
+    }
+    catch (const std::exception&)
+    {
+        used = 0;
+    }
+
+    if (text.empty() || used != text.size() || level < min || level > max)
+        throw std::runtime_error("Bad compression level " + text);
+
+    return level;
+}
+
+#endif
+
+Compression parseCompression(const std::string& compression)
+{
+    Compression result;
+    result.method = compression;
+
+    std::string level;
+    std::size_t colon = compression.find(':');
+    if (colon != std::string::npos)
+    {
+        result.method = compression.substr(0, colon);
+        level = compression.substr(colon + 1);
+    }
+
+    if (result.method.empty())
+    {
+        if (colon != std::string::npos)
+            throw std::runtime_error("Missing compression method in " + compression);
+    }
+    else if (result.method == "gzip")
+    {
+#ifdef DISARMV4T_ZLIB
+        result.level = Z_DEFAULT_COMPRESSION;
+        if (colon != std::string::npos)
+            result.level = parseLevel(level, 0, 9);
+#else
+        throw std::runtime_error("gzip is not supported by this build");
+#endif
+    }
+    else if (result.method == "zstd")
+    {
+#ifdef DISARMV4T_ZSTD
+        result.level = ZSTD_CLEVEL_DEFAULT;
+        if (colon != std::string::npos)
+            result.level = parseLevel(level, ZSTD_minCLevel(), ZSTD_maxCLevel());
+#else
+        throw std::runtime_error("zstd is not supported by this build");
+#endif
+    }
+    else
+    {
+        throw std::runtime_error("Unknown compression " + result.method);
+    }
+    return result;
+}
+
+std::unique_ptr<Sink> makeSink(const fs::path& path, const Compression& compression)
+{
+    std::unique_ptr<FileSink> sink;
+#ifdef DISARMV4T_ZLIB
+    if (compression.method == "gzip")
+        sink = std::make_unique<GzipSink>(path, compression.level);
+#endif
+#ifdef DISARMV4T_ZSTD
+    if (compression.method == "zstd")
+        sink = std::make_unique<ZstdSink>(path, compression.level);
+#endif
+    if (!sink)
+        sink = std::make_unique<FileSink>(path);
+
+    if (!sink->isOpen())
+        return nullptr;
+
+    if (compression.method.empty())
+        return sink;
+
+    return std::make_unique<ThreadedSink>(std::move(sink));
+}
+
+std::unique_ptr<Sink> makeSink(const fs::path& path, const std::string& compression)
+{
+    return makeSink(path, parseCompression(compression));
+}
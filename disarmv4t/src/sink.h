@@ -0,0 +1,35 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include <shell/filesystem.h>
+
+class Sink
+{
+public:
+    virtual ~Sink() = default;
+
+    virtual bool write(std::string block) = 0;
+
+    // Writes a block the caller keeps, so its buffer keeps its capacity.
+    // Sinks that queue blocks copy it into a recycled buffer.
+    virtual bool writeView(std::string_view block) = 0;
+    virtual bool finish() = 0;
+};
+
+struct Compression
+{
+    std::string method;
+    int level = 0;
+};
+
+// Parses "", "gzip[:level]" or "zstd[:level]" and throws for unknown methods,
+// bad levels and methods this build does not support
+Compression parseCompression(const std::string& compression);
+
+// Opens a sink for path, the level is checked before the output is opened,
+// so a bad level cannot truncate an existing file
+std::unique_ptr<Sink> makeSink(const shell::filesystem::path& path, const Compression& compression);
+std::unique_ptr<Sink> makeSink(const shell::filesystem::path& path, const std::string& compression);
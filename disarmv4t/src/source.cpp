@@ -0,0 +1,455 @@
+#include "source.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#ifndef _WIN32
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+#ifdef DISARMV4T_ZLIB
+#  include <zlib.h>
+#endif
+
+#ifdef DISARMV4T_ZSTD
+#  include <zstd.h>
+#endif
+
+namespace fs = shell::filesystem;
+
+// Reads with pread on a descriptor where available, which skips the copy
+// through a stream buffer
+class FileSource : public Source
+{
+public:
+#ifndef _WIN32
+    explicit FileSource(const fs::path& path, u64 offset = 0, u64 limit = std::numeric_limits<u64>::max())
+        : fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC)), offset(offset), limit(limit) {}
+
+    ~FileSource() override
+    {
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+    FileSource(const FileSource&) = delete;
+    FileSource& operator=(const FileSource&) = delete;
+
+    bool isOpen() const
+    {
+        return fd >= 0;
+    }
+#else
+    explicit FileSource(const fs::path& path, u64 offset = 0, u64 limit = std::numeric_limits<u64>::max())
+        : stream(path, std::ios::binary), limit(limit)
+    {
+        stream.seekg(offset);
+    }
+
+    bool isOpen() const
+    {
+        return stream && stream.is_open();
+    }
+#endif
+
+    std::size_t read(u8* data, std::size_t size) override
+    {
+        return readRaw(data, size);
+    }
+
+    bool isBad() const override
+    {
+#ifndef _WIN32
+        return bad || fd < 0;
+#else
+        return bad || stream.bad();
+#endif
+    }
+
+protected:
+    std::size_t readRaw(u8* data, std::size_t size)
+    {
+        size = static_cast<std::size_t>(std::min<u64>(size, limit));
+
+#ifndef _WIN32
+        std::size_t count = 0;
+        while (count < size)
+        {
+            ssize_t result = ::pread(fd, data + count, size - count, static_cast<off_t>(offset));
+            if (result < 0 && errno == EINTR)
+                continue;
+            if (result < 0)
+                bad = true;
+            if (result <= 0)
+                break;
+
+            count  += result;
+            offset += result;
+        }
+#else
+        stream.read(reinterpret_cast<char*>(data), size);
+        std::size_t count = static_cast<std::size_t>(stream.gcount());
+#endif
+
+        limit -= count;
+        return count;
+    }
+
+    bool bad = false;
+
+private:
+#ifndef _WIN32
+    int fd;
+    u64 offset;
+#else
+    std::ifstream stream;
+#endif
+    u64 limit;
+};
+
+#ifdef DISARMV4T_ZLIB
+
+// Inflates gzip and zlib streams or a raw deflate stream of a zip entry
+class InflateSource : public FileSource
+{
+public:
+    InflateSource(const fs::path& path, u64 offset, bool raw)
+        : FileSource(path, offset), raw(raw)
+    {
+        if (inflateInit2(&stream, raw ? -15 : 15 + 32) != Z_OK)
+            throw std::runtime_error("Cannot initialize zlib");
+    }
+
+    ~InflateSource() override
+    {
+        inflateEnd(&stream);
+    }
+
+    std::size_t read(u8* data, std::size_t size) override
+    {
+        stream.next_out  = data;
+        stream.avail_out = static_cast<uInt>(size);
+
+        while (stream.avail_out > 0 && !ended)
+        {
+            if (stream.avail_in == 0)
+            {
+                std::size_t count = readRaw(input, sizeof(input));
+                if (count == 0)
+                {
+                    // The input ended in the middle of a stream
+                    bad = bad || !complete;
+                    ended = true;
+                    break;
+                }
+                stream.next_in  = input;
+                stream.avail_in = static_cast<uInt>(count);
+            }
+
+            int status = ::inflate(&stream, Z_NO_FLUSH);
+            if (status == Z_STREAM_END)
+            {
+                complete = true;
+                if (raw)
+                    ended = true;
+                else
+                    inflateReset(&stream);
+            }
+            else if (status == Z_OK)
+            {
+                complete = false;
+            }
+            else
+            {
+                bad = true;
+                ended = true;
+            }
+        }
+        return size - stream.avail_out;
+    }
+
+private:
+    z_stream stream = {};
+    Bytef input[64 * 1024];
+    bool raw;
+    bool complete = true;
+    bool ended = false;
+};
+
+#endif
+
+#ifdef DISARMV4T_ZSTD
+
+class ZstdSource : public FileSource
+{
+public:
+    explicit ZstdSource(const fs::path& path)
+        : FileSource(path), context(ZSTD_createDCtx())
+    {
+        if (!context)
+            throw std::runtime_error("Cannot initialize zstd");
+    }
+
+    ~ZstdSource() override
+    {
+        ZSTD_freeDCtx(context);
+    }
+
+    std::size_t read(u8* data, std::size_t size) override
+    {
+        ZSTD_outBuffer output = { data, size, 0 };
+
+        while (output.pos < output.size && !ended)
+        {
+            if (buffer.pos == buffer.size)
+            {
+                std::size_t count = readRaw(input, sizeof(input));
+                if (count == 0)
+                {
+                    bad = bad || remaining != 0;
+                    ended = true;
+                    break;
+                }
+                buffer = { input, count, 0 };
+            }
+
+            remaining = ZSTD_decompressStream(context, &output, &buffer);
+            if (ZSTD_isError(remaining))
+            {
+                bad = true;
+                ended = true;
+            }
+        }
+        return output.pos;
+    }
+
+private:
+    ZSTD_DCtx* context;
+    ZSTD_inBuffer buffer = { nullptr, 0, 0 };
+    u8 input[64 * 1024];
+    std::size_t remaining = 0;
+    bool ended = false;
+};
+
+#endif
+
+// Runs the wrapped source on a separate thread so decompression overlaps disassembly
+class ThreadedSource : public Source
+{
+public:
+    static constexpr std::size_t kBlockSize = 256 * 1024;
+    static constexpr std::size_t kMaxBlocks = 4;
+
+    explicit ThreadedSource(std::unique_ptr<Source> source)
+        : source(std::move(source))
+    {
+        thread = std::thread([this]() { run(); });
+    }
+
+    ~ThreadedSource() override
+    {
+        {
+            std::lock_guard lock(mutex);
+            stopped = true;
+        }
+        condition.notify_all();
+        thread.join();
+    }
+
+    std::size_t read(u8* data, std::size_t size) override
+    {
+        std::size_t count = 0;
+        while (count < size)
+        {
+            if (position == block.size())
+            {
+                std::unique_lock lock(mutex);
+                condition.wait(lock, [this]() { return !blocks.empty() || ended; });
+
+                if (blocks.empty())
+                    break;
+
+                block = std::move(blocks.front());
+                blocks.pop_front();
+                position = 0;
+                condition.notify_all();
+            }
+
+            std::size_t take = std::min(size - count, block.size() - position);
+            std::memcpy(data + count, block.data() + position, take);
+            position += take;
+            count += take;
+        }
+        return count;
+    }
+
+    bool isBad() const override
+    {
+        std::lock_guard lock(mutex);
+        return bad;
+    }
+
+private:
+    void run()
+    {
+        while (true)
+        {
+            std::vector<u8> data(kBlockSize);
+            data.resize(source->read(data.data(), data.size()));
+
+            std::unique_lock lock(mutex);
+            if (data.empty())
+            {
+                bad = source->isBad();
+                ended = true;
+                condition.notify_all();
+                return;
+            }
+
+            condition.wait(lock, [this]() { return blocks.size() < kMaxBlocks || stopped; });
+            if (stopped)
+                return;
+
+            blocks.push_back(std::move(data));
+            condition.notify_all();
+        }
+    }
+
+    std::unique_ptr<Source> source;
+    std::thread thread;
+    mutable std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<std::vector<u8>> blocks;
+    std::vector<u8> block;
+    std::size_t position = 0;
+    bool stopped = false;
+    bool ended = false;
+    bool bad = false;
+};
+
+template<typename T>
+static T load(const u8* data)
+{
+    T value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static std::string methodFor(const fs::path& path)
+{
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+
+    if (extension == ".gz")
+        return "gzip";
+    if (extension == ".zst" || extension == ".zstd")
+        return "zstd";
+    if (extension == ".zip")
+        return "zip";
+    return "none";
+}
+
+std::unique_ptr<Source> makeSource(const fs::path& path, const std::string& decompression)
+{
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream || !stream.is_open())
+        return nullptr;
+
+    // Raw images can start with anything, so the magic bytes only confirm
+    // what the extension or the explicit method already claims
+    bool forced = !decompression.empty();
+    std::string method = forced ? decompression : methodFor(path);
+    if (method != "none" && method != "gzip" && method != "zstd" && method != "zip")
+        throw std::runtime_error("Unknown decompression " + method);
+
+    // Enough for the fixed part of a zip local file header
+    u8 header[30] = {};
+    stream.read(reinterpret_cast<char*>(header), sizeof(header));
+    std::size_t size = static_cast<std::size_t>(stream.gcount());
+
+    bool matches = false;
+    if (method == "gzip")
+        matches = size >= 2 && header[0] == 0x1F && header[1] == 0x8B;
+    else if (method == "zstd")
+        matches = size >= 4 && load<u32>(header) == 0xFD2FB528;
+    else if (method == "zip")
+        matches = size == sizeof(header) && load<u32>(header) == 0x04034B50;
+
+    if (!matches)
+    {
+        if (forced && method != "none")
+            throw std::runtime_error("Input is not " + method);
+        return std::make_unique<FileSource>(path);
+    }
+
+    std::unique_ptr<Source> source;
+    if (method == "gzip")
+    {
+#ifdef DISARMV4T_ZLIB
+        source = std::make_unique<InflateSource>(path, 0, false);
+#else
+        throw std::runtime_error("gzip is not supported by this build");
+#endif
+    }
+    else if (method == "zstd")
+    {
+#ifdef DISARMV4T_ZSTD
+        source = std::make_unique<ZstdSource>(path);
+#else
+        throw std::runtime_error("zstd is not supported by this build");
+#endif
+    }
+    else
+    {
+        // Only the first entry of a zip file is read
+        u16 flags  = load<u16>(header + 6);
+        u16 compression = load<u16>(header + 8);
+        u32 length = load<u32>(header + 18);
+        u64 offset = sizeof(header) + load<u16>(header + 26) + load<u16>(header + 28);
+
+        if (compression == 0 && !(flags & 0x8))
+        {
+            source = std::make_unique<FileSource>(path, offset, length);
+        }
+        else if (compression == 8)
+        {
+#ifdef DISARMV4T_ZLIB
+            source = std::make_unique<InflateSource>(path, offset, true);
+#else
+            throw std::runtime_error("zip is not supported by this build");
+#endif
+        }
+        else
+        {
+            throw std::runtime_error("Unsupported zip entry");
+        }
+    }
+    return std::make_unique<ThreadedSource>(std::move(source));
+}
+
+std::vector<u8> readAll(Source& source)
+{
+    std::vector<u8> data;
+    std::size_t size = 0;
+    do
+    {
+        data.resize(size + ThreadedSource::kBlockSize);
+        size += source.read(data.data() + size, ThreadedSource::kBlockSize);
+    }
+    while (size == data.size());
+
+    data.resize(size);
+    return data;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <shell/filesystem.h>
+
+#include "int.h"
+
+class Source
+{
+public:
+    virtual ~Source() = default;
+
+    // Reads up to size bytes and returns less only at the end or on errors
+    virtual std::size_t read(u8* data, std::size_t size) = 0;
+    virtual bool isBad() const = 0;
+};
+
+// Opens a source for path, decompression is "" (by extension), "none", "gzip",
+// "zstd" or "zip". Compressed files are decompressed on a separate thread.
+std::unique_ptr<Source> makeSource(const shell::filesystem::path& path, const std::string& decompression);
+
+std::vector<u8> readAll(Source& source);
@@ -0,0 +1,92 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+#include <shell/constants.h>
+
+#include "branch.h"
+#include "disassemble.h"
+
+Trace::Trace(const Format& format)
+    : format(format), cache(kCacheSize) {}
+
+void Trace::render(std::string& out, const u8* data, std::size_t size)
+{
+    if (pending)
+    {
+        std::size_t length = std::min(kRecordSize - pending, size);
+        std::memcpy(partial + pending, data, length);
+        pending += length;
+        data += length;
+        size -= length;
+
+        if (pending < kRecordSize)
+            return;
+
+        renderRecord(out, partial);
+        pending = 0;
+    }
+
+    std::size_t index = 0;
+    for (; index + kRecordSize <= size; index += kRecordSize)
+        renderRecord(out, data + index);
+
+    pending = size - index;
+    std::memcpy(partial, data + index, pending);
+}
+
+bool Trace::finish() const
+{
+    return pending == 0;
+}
+
+void Trace::renderRecord(std::string& out, const u8* record)
+{
+    u32 pc;
+    u32 instr;
+    std::memcpy(&pc, record, sizeof(pc));
+    std::memcpy(&instr, record + 4, sizeof(instr));
+
+    bool thumb = pc & 0x1;
+    if (thumb)
+        instr &= 0xFFFF;
+
+    // The second half of a long branch depends on the lr of the first
+    bool dynamic = thumb && (instr & 0xF800) == 0xF800;
+    if (dynamic)
+    {
+        renderLine(out, pc, instr);
+    }
+    else
+    {
+        Entry& entry = cache[(pc >> 1) & (kCacheSize - 1)];
+        if (entry.line.empty() || entry.pc != pc || entry.instr != instr)
+        {
+            entry.pc = pc;
+            entry.instr = instr;
+            entry.line.clear();
+            renderLine(entry.line, pc, instr);
+        }
+        out.append(entry.line);
+    }
+
+    if (thumb)
+        lr = thumbLongBranchSetup(static_cast<u16>(instr), (pc & ~0x1) + 4);
+}
+
+void Trace::renderLine(std::string& out, u32 pc, u32 instr)
+{
+    char mnemonic[kMaxMnemonicSize];
+    char* end;
+
+    u32 addr = pc & ~0x1;
+    if (pc & 0x1)
+        end = disassemble(static_cast<u16>(instr), addr + 4, lr, mnemonic);
+    else
+        end = disassemble(instr, addr + 8, mnemonic);
+
+    format.render(out, addr, instr, std::string_view(mnemonic, end - mnemonic));
+    out.append(shell::kLineBreak);
+}
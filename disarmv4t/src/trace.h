@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "format.h"
+#include "int.h"
+
+// Renders emulator traces made of little-endian (pc, instr) u32 pairs where
+// bit 0 of pc selects Thumb. Rendered lines are cached by (pc, instr).
+class Trace
+{
+public:
+    static constexpr std::size_t kRecordSize = 8;
+
+    explicit Trace(const Format& format);
+
+    // Records may be split between calls
+    void render(std::string& out, const u8* data, std::size_t size);
+
+    // Returns false if the trace ended inside a record
+    bool finish() const;
+
+private:
+    static constexpr std::size_t kCacheSize = 1 << 16;
+
+    struct Entry
+    {
+        u32 pc = 0;
+        u32 instr = 0;
+        std::string line;
+    };
+
+    void renderRecord(std::string& out, const u8* record);
+    void renderLine(std::string& out, u32 pc, u32 instr);
+
+    const Format& format;
+    std::vector<Entry> cache;
+    u32 lr = 0;
+    u8 partial[kRecordSize] = {};
+    std::size_t pending = 0;
+};
@@ -0,0 +1,476 @@
+#include "viewer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <shell/fmt.h>
+
+#include "branch.h"
+#include "decode.h"
+#include "listing.h"
+#include "mapped.h"
+
+#ifndef _WIN32
+#  include <sys/ioctl.h>
+#  include <termios.h>
+#  include <unistd.h>
+#endif
+
+namespace fs = shell::filesystem;
+
+#ifndef _WIN32
+
+// Decodes only the visible lines and the pages around them. Lines are kept
+// in a direct-mapped cache keyed by offset and mode, so scrolling back and
+// forth does not decode them again.
+class Viewer
+{
+public:
+    static constexpr std::size_t kCacheSize = 1 << 12;
+
+    Viewer(const MappedFile& file, const Format& format, u32 addr, bool thumb)
+        : file(file), format(format), addr(addr), cache(kCacheSize)
+    {
+        modes[0] = thumb;
+    }
+
+    void run()
+    {
+        while (true)
+        {
+            resize();
+            draw();
+            prefetch();
+
+            std::string key = read();
+            message.clear();
+
+            if (key == "q" || key == "\x03")
+                return;
+            else if (key == "j" || key == "\x1b[B")
+                down(1);
+            else if (key == "k" || key == "\x1b[A")
+                up(1);
+            else if (key == " " || key == "\x1b[6~")
+                down(rows - 1);
+            else if (key == "\x1b[5~")
+                up(rows - 1);
+            else if (key == "g")
+                prompt();
+            else if (key == "f" || key == "\r")
+                follow();
+            else if (key == "b" || key == "\x7f")
+                back();
+            else if (key == "t")
+                toggle();
+        }
+    }
+
+private:
+    bool isThumb(u64 offset) const
+    {
+        return std::prev(modes.upper_bound(offset))->second;
+    }
+
+    uint width(u64 offset) const
+    {
+        return isThumb(offset) ? 2 : 4;
+    }
+
+    u64 next(u64 offset) const
+    {
+        return offset + width(offset);
+    }
+
+    u64 previous(u64 offset) const
+    {
+        if (offset == 0)
+            return 0;
+
+        uint size = width(offset - 1);
+        return offset < size ? 0 : offset - size;
+    }
+
+    const std::string& line(u64 offset)
+    {
+        bool thumb = isThumb(offset);
+
+        Entry& entry = cache[(offset >> 1) % kCacheSize];
+        if (entry.offset == offset && entry.thumb == thumb)
+            return entry.line;
+
+        entry.offset = offset;
+        entry.thumb  = thumb;
+        entry.line.clear();
+
+        uint size = thumb ? 2 : 4;
+        if (offset + size > file.size())
+            return entry.line;
+
+        // The lr only depends on the previous halfword
+        u32 lr = 0;
+        if (thumb && offset >= 2)
+        {
+            u16 prev;
+            std::memcpy(&prev, file.data() + offset - 2, sizeof(prev));
+            lr = thumbLongBranchSetup(prev, addr + static_cast<u32>(offset) + 2);
+        }
+
+        listing(entry.line, format, file.data() + offset, size, addr + static_cast<u32>(offset), thumb, lr);
+        while (!entry.line.empty() && (entry.line.back() == '\n' || entry.line.back() == '\r'))
+            entry.line.pop_back();
+
+        return entry.line;
+    }
+
+    bool target(u64 offset, u32& target) const
+    {
+        u32 pc = addr + static_cast<u32>(offset);
+        if (!isThumb(offset))
+        {
+            if (offset + 4 > file.size())
+                return false;
+
+            u32 instr;
+            std::memcpy(&instr, file.data() + offset, sizeof(instr));
+            if (decodeArm(hashArm(instr)) != InstructionArm::BranchLink)
+                return false;
+
+            target = armBranchTarget(instr, pc + 8);
+            return true;
+        }
+
+        if (offset + 2 > file.size())
+            return false;
+
+        u16 instr;
+        std::memcpy(&instr, file.data() + offset, sizeof(instr));
+
+        switch (decodeThumb(hashThumb(instr)))
+        {
+        case InstructionThumb::ConditionalBranch:
+            target = thumbConditionalTarget(instr, pc + 4);
+            return true;
+
+        case InstructionThumb::UnconditionalBranch:
+            target = thumbBranchTarget(instr, pc + 4);
+            return true;
+
+        case InstructionThumb::LongBranchLink:
+        {
+            // Either half of the pair follows the call
+            u16 setup = instr;
+            u16 link  = instr;
+            if (bit::seq<11, 1>(instr))
+            {
+                if (offset < 2)
+                    return false;
+
+                std::memcpy(&setup, file.data() + offset - 2, sizeof(setup));
+                pc -= 2;
+            }
+            else
+            {
+                if (offset + 4 > file.size())
+                    return false;
+
+                std::memcpy(&link, file.data() + offset + 2, sizeof(link));
+            }
+
+            target = thumbLongBranchTarget(link, thumbLongBranchSetup(setup, pc + 4));
+            return true;
+        }
+
+        default:
+            return false;
+        }
+    }
+
+    void down(uint count)
+    {
+        while (count-- > 0 && next(cursor) < file.size())
+        {
+            cursor = next(cursor);
+            if (++row >= rows - 1)
+            {
+                top = next(top);
+                row--;
+            }
+        }
+    }
+
+    void up(uint count)
+    {
+        while (count-- > 0 && cursor > 0)
+        {
+            cursor = previous(cursor);
+            if (row == 0)
+                top = cursor;
+            else
+                row--;
+        }
+    }
+
+    void jump(u32 target, bool remember)
+    {
+        u64 offset = static_cast<u32>(target - addr);
+        if (offset >= file.size())
+        {
+            message = fmt::format("{:08X} is outside of the input", target);
+            return;
+        }
+
+        if (remember)
+            history.push_back(cursor);
+
+        cursor = offset - offset % width(offset);
+        top = cursor;
+        row = 0;
+
+        // Keep some lines above the target visible
+        for (uint x = 0; x < (rows - 1) / 3 && top > 0; ++x, ++row)
+            top = previous(top);
+    }
+
+    void follow()
+    {
+        u32 address;
+        if (target(cursor, address))
+            jump(address, true);
+        else
+            message = "Not a branch";
+    }
+
+    void back()
+    {
+        if (history.empty())
+            return;
+
+        u64 offset = history.back();
+        history.pop_back();
+        jump(addr + static_cast<u32>(offset), false);
+    }
+
+    void toggle()
+    {
+        // Switches the mode from the cursor up to the next switch
+        modes[cursor] = !isThumb(cursor);
+    }
+
+    void prompt()
+    {
+        std::string text;
+        while (true)
+        {
+            message = "Goto: " + text;
+            draw();
+
+            std::string key = read();
+            if (key == "\r")
+                break;
+            if (key == "\x1b" || key == "\x03")
+            {
+                message.clear();
+                return;
+            }
+            if (key == "\x7f" && !text.empty())
+                text.pop_back();
+            else if (key.size() == 1 && text.size() < 8 && std::isxdigit(static_cast<unsigned char>(key[0])))
+                text.append(key);
+        }
+
+        message.clear();
+        if (!text.empty())
+            jump(static_cast<u32>(std::stoul(text, nullptr, 16)), true);
+    }
+
+    void prefetch()
+    {
+        u64 offset = top;
+        for (uint x = 0; x < 2 * rows && offset < file.size(); ++x, offset = next(offset))
+            line(offset);
+
+        offset = top;
+        for (uint x = 0; x < rows && offset > 0; ++x)
+            line(offset = previous(offset));
+    }
+
+    void resize()
+    {
+        winsize size;
+        if (::ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_row > 1 && size.ws_col > 0)
+        {
+            rows = size.ws_row;
+            cols = size.ws_col;
+        }
+
+        if (row >= rows - 1)
+        {
+            row = 0;
+            top = cursor;
+        }
+    }
+
+    void draw()
+    {
+        std::string frame = "\x1b[H";
+
+        u64 offset = top;
+        for (uint x = 0; x < rows - 1; ++x)
+        {
+            if (offset < file.size())
+            {
+                std::string_view text = line(offset);
+                text = text.substr(0, cols);
+
+                if (offset == cursor)
+                    frame.append("\x1b[7m");
+                frame.append(text);
+                if (offset == cursor)
+                    frame.append("\x1b[0m");
+
+                offset = next(offset);
+            }
+            else
+            {
+                frame.push_back('~');
+            }
+            frame.append("\x1b[K\r\n");
+        }
+
+        std::string status = message.empty()
+            ? fmt::format("{:08X} {}  g goto  f follow  b back  t mode  q quit", addr + static_cast<u32>(cursor), isThumb(cursor) ? "thumb" : "arm")
+            : message;
+
+        frame.append("\x1b[7m");
+        frame.append(status.substr(0, cols));
+        frame.append("\x1b[K\x1b[0m");
+
+        ::write(STDOUT_FILENO, frame.data(), frame.size());
+    }
+
+    // One read can return several keys when pasting or repeating keys
+    // quickly, so they are split and returned one at a time. Escape
+    // sequences like "\x1b[A" or "\x1b[5~" end at their final byte.
+    std::string read()
+    {
+        if (input.empty())
+        {
+            char buffer[64];
+            ssize_t count = ::read(STDIN_FILENO, buffer, sizeof(buffer));
+            if (count <= 0)
+                return "q";
+
+            input.assign(buffer, count);
+        }
+
+        std::size_t length = 1;
+        if (input[0] == '\x1b' && input.size() >= 3 && input[1] == 'O')
+        {
+            length = 3;
+        }
+        else if (input[0] == '\x1b' && input.size() >= 3 && input[1] == '[')
+        {
+            length = 2;
+            while (length < input.size() && (input[length] < 0x40 || input[length] > 0x7E))
+                length++;
+            length = std::min(length + 1, input.size());
+        }
+
+        std::string key = input.substr(0, length);
+        input.erase(0, length);
+        return key;
+    }
+
+    struct Entry
+    {
+        u64 offset = ~u64(0);
+        bool thumb = false;
+        std::string line;
+    };
+
+    const MappedFile& file;
+    const Format& format;
+    u32 addr;
+    u64 top = 0;
+    u64 cursor = 0;
+    uint row = 0;
+    uint rows = 24;
+    uint cols = 80;
+    std::string message;
+    std::map<u64, bool> modes;
+    std::vector<u64> history;
+    std::vector<Entry> cache;
+    std::string input;
+};
+
+// Switches the terminal to raw mode and the alternate screen and restores it
+// when leaving the scope, also if rendering throws. Signals from keys are
+// disabled, Ctrl-C arrives as a key and quits through the destructor.
+class Terminal
+{
+public:
+    Terminal()
+    {
+        ::tcgetattr(STDIN_FILENO, &saved);
+
+        termios raw = saved;
+        raw.c_iflag &= ~(ICRNL | IXON);
+        raw.c_lflag &= ~(ICANON | ECHO | ISIG);
+        raw.c_cc[VMIN]  = 1;
+        raw.c_cc[VTIME] = 0;
+        ::tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+
+        std::string_view enter = "\x1b[?1049h\x1b[?25l";
+        ::write(STDOUT_FILENO, enter.data(), enter.size());
+    }
+
+    ~Terminal()
+    {
+        std::string_view leave = "\x1b[?25h\x1b[?1049l";
+        ::write(STDOUT_FILENO, leave.data(), leave.size());
+
+        ::tcsetattr(STDIN_FILENO, TCSAFLUSH, &saved);
+    }
+
+    Terminal(const Terminal&) = delete;
+    Terminal& operator=(const Terminal&) = delete;
+
+private:
+    termios saved;
+};
+
+int view(const fs::path& input, const Format& format, u32 addr, bool thumb)
+{
+    MappedFile file(input);
+    if (!file.isOpen())
+    {
+        fmt::print("Cannot read file {}", input);
+        return 1;
+    }
+
+    if (!::isatty(STDIN_FILENO) || !::isatty(STDOUT_FILENO))
+    {
+        fmt::print("Viewing requires a terminal");
+        return 7;
+    }
+
+    Terminal terminal;
+    Viewer(file, format, addr, thumb).run();
+    return 0;
+}
+
+#else
+
+int view(const fs::path& input, const Format& format, u32 addr, bool thumb)
+{
+    fmt::print("Viewing is not supported on this platform");
+    return 7;
+}
+
+#endif
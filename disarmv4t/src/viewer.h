@@ -0,0 +1,8 @@
+#pragma once
+
+#include <shell/filesystem.h>
+
+#include "format.h"
+#include "int.h"
+
+int view(const shell::filesystem::path& input, const Format& format, u32 addr, bool thumb);
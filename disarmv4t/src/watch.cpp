@@ -0,0 +1,303 @@
+#include "watch.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <shell/fmt.h>
+
+#include "branch.h"
+#include "listing.h"
+
+#ifdef __linux__
+#  include <fcntl.h>
+#  include <sys/inotify.h>
+#  include <unistd.h>
+#endif
+
+namespace fs = shell::filesystem;
+
+#ifdef __linux__
+
+static constexpr std::size_t kPageSize = 4096;
+
+struct Watched
+{
+    std::vector<u8> data;
+    std::vector<u64> offsets;
+};
+
+static bool read(const fs::path& input, bool thumb, std::vector<u8>& data)
+{
+    auto [status, content] = fs::read<std::vector<u8>>(input);
+    if (status != fs::Status::Ok)
+        return false;
+
+    std::size_t size = thumb ? 2 : 4;
+    content.resize(content.size() + content.size() % size, 0);
+
+    data = std::move(content);
+    return true;
+}
+
+static std::string renderPage(const Format& format, const std::vector<u8>& data, std::size_t page, u32 addr, bool thumb)
+{
+    std::size_t begin = page * kPageSize;
+    std::size_t end   = std::min(begin + kPageSize, data.size());
+
+    // The second half of a long branch depends on the last instruction of the previous page
+    u32 lr = 0;
+    if (thumb && begin >= 2)
+    {
+        u16 prev;
+        std::memcpy(&prev, data.data() + begin - 2, sizeof(prev));
+        lr = thumbLongBranchSetup(prev, addr + static_cast<u32>(begin) + 2);
+    }
+
+    std::string text;
+    listing(text, format, data.data() + begin, end - begin, addr + static_cast<u32>(begin), thumb, lr);
+    return text;
+}
+
+static bool writeAll(int fd, const char* data, std::size_t size, u64 offset)
+{
+    while (size > 0)
+    {
+        ssize_t written = ::pwrite(fd, data, size, offset);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+
+        data   += written;
+        size   -= written;
+        offset += written;
+    }
+    return true;
+}
+
+static bool readAll(int fd, char* data, std::size_t size, u64 offset)
+{
+    while (size > 0)
+    {
+        ssize_t read = ::pread(fd, data, size, offset);
+        if (read <= 0)
+        {
+            if (read < 0 && errno == EINTR)
+                continue;
+            return false;
+        }
+
+        data   += read;
+        size   -= read;
+        offset += read;
+    }
+    return true;
+}
+
+static bool rewrite(int fd, Watched& watched, const Format& format, u32 addr, bool thumb)
+{
+    std::size_t pages = (watched.data.size() + kPageSize - 1) / kPageSize;
+
+    std::string text;
+    watched.offsets.assign(1, 0);
+    for (std::size_t page = 0; page < pages; ++page)
+    {
+        text.append(renderPage(format, watched.data, page, addr, thumb));
+        watched.offsets.push_back(text.size());
+    }
+    return writeAll(fd, text.data(), text.size(), 0) && ::ftruncate(fd, text.size()) == 0;
+}
+
+static bool update(int fd, Watched& watched, std::vector<u8>& data, const Format& format, u32 addr, bool thumb)
+{
+    std::size_t pages = (data.size() + kPageSize - 1) / kPageSize;
+
+    std::vector<std::size_t> dirty;
+    for (std::size_t page = 0; page < pages; ++page)
+    {
+        std::size_t begin = page * kPageSize;
+        std::size_t end   = std::min(begin + kPageSize, data.size());
+
+        bool changed = std::memcmp(watched.data.data() + begin, data.data() + begin, end - begin) != 0;
+
+        // A changed last instruction changes lr for the first one of the next page
+        bool neighbour = thumb && !dirty.empty() && dirty.back() == page - 1
+            && std::memcmp(watched.data.data() + begin - 2, data.data() + begin - 2, 2) != 0;
+
+        if (changed || neighbour)
+            dirty.push_back(page);
+    }
+
+    watched.data = std::move(data);
+
+    if (dirty.empty())
+        return true;
+
+    std::vector<std::string> texts;
+    texts.reserve(dirty.size());
+    for (std::size_t page : dirty)
+        texts.push_back(renderPage(format, watched.data, page, addr, thumb));
+
+    // Pages keeping their size are written in place, the first page
+    // changing its size moves everything behind it
+    std::size_t index = 0;
+    for (; index < dirty.size(); ++index)
+    {
+        std::size_t page = dirty[index];
+        if (texts[index].size() != watched.offsets[page + 1] - watched.offsets[page])
+            break;
+
+        if (!writeAll(fd, texts[index].data(), texts[index].size(), watched.offsets[page]))
+            return false;
+    }
+
+    if (index < dirty.size())
+    {
+        std::size_t first = dirty[index];
+        u64 begin = watched.offsets[first];
+
+        std::unique_ptr<char[]> tail(new char[watched.offsets[pages] - begin]);
+        if (!readAll(fd, tail.get(), watched.offsets[pages] - begin, begin))
+            return false;
+
+        // Runs of unchanged pages are written straight from the old tail
+        std::vector<u64> offsets(watched.offsets.begin(), watched.offsets.begin() + first + 1);
+        for (std::size_t page = first; page < pages; )
+        {
+            u64 offset = offsets.back();
+            if (index < dirty.size() && dirty[index] == page)
+            {
+                if (!writeAll(fd, texts[index].data(), texts[index].size(), offset))
+                    return false;
+
+                offsets.push_back(offset + texts[index].size());
+                index++;
+                page++;
+                continue;
+            }
+
+            std::size_t last = index < dirty.size() ? dirty[index] : pages;
+            u64 from = watched.offsets[page];
+            u64 size = watched.offsets[last] - from;
+            if (!writeAll(fd, tail.get() + (from - begin), size, offset))
+                return false;
+
+            for (; page < last; ++page)
+                offsets.push_back(offsets.back() + watched.offsets[page + 1] - watched.offsets[page]);
+        }
+
+        if (::ftruncate(fd, offsets.back()) != 0)
+            return false;
+
+        watched.offsets = std::move(offsets);
+    }
+
+    fmt::print("Updated {} pages\n", dirty.size());
+    std::fflush(stdout);
+    return true;
+}
+
+int watch(const fs::path& input, const fs::path& output, const Format& format, u32 addr, bool thumb)
+{
+    Watched watched;
+    if (!read(input, thumb, watched.data))
+    {
+        fmt::print("Cannot read file {}", input);
+        return 1;
+    }
+
+    int fd = ::open(output.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        fmt::print("Cannot open file {}", output);
+        return 2;
+    }
+
+    if (!rewrite(fd, watched, format, addr, thumb))
+    {
+        fmt::print("Cannot write file {}", output);
+        ::close(fd);
+        return 2;
+    }
+
+    // Watch the directory to also see files replaced by a rename
+    fs::path directory = input.parent_path();
+    if (directory.empty())
+        directory = ".";
+
+    int notify = ::inotify_init1(IN_CLOEXEC);
+    if (notify < 0 || ::inotify_add_watch(notify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        fmt::print("Cannot watch file {}", input);
+        ::close(fd);
+        return 5;
+    }
+
+    const std::string name = input.filename().string();
+
+    alignas(inotify_event) char buffer[16 * 1024];
+    while (true)
+    {
+        ssize_t length = ::read(notify, buffer, sizeof(buffer));
+        if (length < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        bool changed = false;
+        for (ssize_t offset = 0; offset < length; )
+        {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            if (event->len > 0 && name == event->name)
+                changed = true;
+
+            offset += sizeof(inotify_event) + event->len;
+        }
+
+        std::vector<u8> data;
+        if (!changed || !read(input, thumb, data))
+            continue;
+
+        bool ok;
+        if (data.size() == watched.data.size())
+        {
+            ok = update(fd, watched, data, format, addr, thumb);
+        }
+        else
+        {
+            watched.data = std::move(data);
+            ok = rewrite(fd, watched, format, addr, thumb);
+            fmt::print("Updated all pages\n");
+            std::fflush(stdout);
+        }
+
+        if (!ok)
+        {
+            fmt::print("Cannot write file {}", output);
+            break;
+        }
+    }
+
+    ::close(notify);
+    ::close(fd);
+    return 5;
+}
+
+#else
+
+int watch(const fs::path& input, const fs::path& output, const Format& format, u32 addr, bool thumb)
+{
+    fmt::print("Watching is not supported on this platform");
+    return 5;
+}
+
+#endif
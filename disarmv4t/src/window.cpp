@@ -0,0 +1,92 @@
+#include "window.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "branch.h"
+#include "decode.h"
+#include "disassemble.h"
+
+DisasmWindow::DisasmWindow(uint before, uint after)
+    : before(before), after(after) {}
+
+uint DisasmWindow::update(const u8* data, std::size_t size, u32 base, u32 pc, bool thumb)
+{
+    const u32 width = thumb ? 2 : 4;
+
+    u64 offset = static_cast<u32>(pc - base);
+    offset -= offset % width;
+
+    u64 begin = offset - std::min<u64>(offset, u64(before) * width);
+    u64 end   = std::min<u64>(offset + (u64(after) + 1) * width, size - size % width);
+
+    // Lines are reused rather than cleared to keep the capacity of their strings
+    std::size_t count = end > begin ? (end - begin) / width : 0;
+    spare.resize(count);
+    spare_links.resize(count);
+
+    uint rendered = 0;
+    char mnemonic[kMaxMnemonicSize];
+    for (std::size_t x = 0; x < count; ++x)
+    {
+        u64 index = begin + x * width;
+
+        Line& line = spare[x];
+        line.addr  = base + static_cast<u32>(index);
+        line.thumb = thumb;
+
+        // The second half of a Thumb long branch also depends on the first
+        u32 link = 0;
+        if (thumb)
+        {
+            u16 instr;
+            std::memcpy(&instr, data + index, sizeof(instr));
+            line.instr = instr;
+
+            if (decodeThumb(hashThumb(instr)) == InstructionThumb::LongBranchLink && bit::seq<11, 1>(instr) && index >= 2)
+            {
+                u16 setup;
+                std::memcpy(&setup, data + index - 2, sizeof(setup));
+                link = thumbLongBranchSetup(setup, line.addr + 2);
+            }
+        }
+        else
+        {
+            std::memcpy(&line.instr, data + index, sizeof(line.instr));
+        }
+        spare_links[x] = link;
+
+        // The previous window is contiguous, so the old line is found by offset
+        if (!current.empty() && current.front().thumb == thumb)
+        {
+            u32 distance = line.addr - current.front().addr;
+            std::size_t old = distance / width;
+            if (distance % width == 0 && old < current.size())
+            {
+                Line& previous = current[old];
+                if (previous.instr == line.instr && links[old] == link)
+                {
+                    std::swap(line.mnemonic, previous.mnemonic);
+                    continue;
+                }
+            }
+        }
+
+        char* last = thumb
+            ? disassemble(static_cast<u16>(line.instr), line.addr + 4, link, mnemonic)
+            : disassemble(line.instr, line.addr + 8, mnemonic);
+
+        line.mnemonic.assign(mnemonic, last);
+        rendered++;
+    }
+
+    std::swap(current, spare);
+    std::swap(links, spare_links);
+    return rendered;
+}
+
+const std::vector<DisasmWindow::Line>& DisasmWindow::lines() const
+{
+    return current;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "int.h"
+
+// Disassembly window around the pc for debuggers. Lines are keyed by
+// address, raw instruction and mode, so update() only renders lines whose
+// memory changed or which scrolled into the window.
+class DisasmWindow
+{
+public:
+    struct Line
+    {
+        u32 addr;
+        u32 instr;
+        bool thumb;
+        std::string mnemonic;
+    };
+
+    DisasmWindow(uint before, uint after);
+
+    // Moves the window to pc and returns the number of rendered lines. Lines
+    // outside of the memory [base, base + size) are left out.
+    uint update(const u8* data, std::size_t size, u32 base, u32 pc, bool thumb);
+
+    const std::vector<Line>& lines() const;
+
+private:
+    uint before;
+    uint after;
+    std::vector<Line> current;
+    std::vector<Line> spare;
+    std::vector<u32> links;
+    std::vector<u32> spare_links;
+};
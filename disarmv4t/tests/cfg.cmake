@@ -0,0 +1,35 @@
+# Writes the control flow graph of fixed ARM and Thumb inputs as DOT and as
+# an edge list and compares them with checked-in output. The Thumb input at
+# base 1 has a call to an address between two instructions, whose edge must
+# be dropped.
+#   cmake -DBINARY=<path> -P cfg.cmake
+
+if (NOT BINARY)
+  message(FATAL_ERROR "Expected -DBINARY=<path>")
+endif()
+
+set(data ${CMAKE_CURRENT_LIST_DIR}/data)
+
+function(check name expected)
+  execute_process(
+    COMMAND ${BINARY} ${ARGN} cfg.txt
+    RESULT_VARIABLE result
+    OUTPUT_VARIABLE output
+    ERROR_VARIABLE output)
+
+  if (NOT result EQUAL 0)
+    message(SEND_ERROR "${name}: failed with ${result}: ${output}")
+  else()
+    file(READ cfg.txt actual)
+    file(READ ${data}/${expected} wanted)
+    if (NOT actual STREQUAL wanted)
+      message(SEND_ERROR "${name}: output differs from ${expected}")
+    endif()
+  endif()
+endfunction()
+
+check("arm dot"     cfg-arm.dot        -b 0x8000000    -g dot   ${data}/arm.bin)
+check("arm edges"   cfg-arm.txt        -b 0x8000000    -g edges ${data}/arm.bin)
+check("thumb dot"   cfg-thumb.dot      -b 0x8000000 -t -g dot   ${data}/thumb.bin)
+check("thumb edges" cfg-thumb.txt      -b 0x8000000 -t -g edges ${data}/thumb.bin)
+check("thumb odd"   cfg-thumb-odd.txt  -b 1         -t -g edges ${data}/thumb.bin)
@@ -0,0 +1,35 @@
+# Annotates fixed ARM and Thumb inputs with cycle costs and compares them with
+# checked-in listings. The inputs contain undefined instructions and blocks
+# of a single instruction.
+#   cmake -DBINARY=<path> -P cycles.cmake
+
+if (NOT BINARY)
+  message(FATAL_ERROR "Expected -DBINARY=<path>")
+endif()
+
+set(data ${CMAKE_CURRENT_LIST_DIR}/data)
+
+foreach (mode arm thumb)
+  set(args -y rom)
+  if (mode STREQUAL "thumb")
+    set(args -t -y iwram)
+  endif()
+
+  set(expected ${data}/cycles-${mode}.txt)
+
+  execute_process(
+    COMMAND ${BINARY} ${args} -b 0x8000000 ${data}/${mode}.bin cycles.txt
+    RESULT_VARIABLE result
+    OUTPUT_VARIABLE output
+    ERROR_VARIABLE output)
+
+  if (NOT result EQUAL 0)
+    message(SEND_ERROR "${mode}: failed with ${result}: ${output}")
+  else()
+    file(READ cycles.txt actual)
+    file(READ ${expected} wanted)
+    if (NOT actual STREQUAL wanted)
+      message(SEND_ERROR "${mode}: output differs from ${expected}")
+    endif()
+  endif()
+endforeach()
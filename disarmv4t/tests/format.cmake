@@ -0,0 +1,47 @@
+# Renders fixed ARM and Thumb inputs with the default format and specs the
+# segment compiler handles, and one it leaves to fmt. The expected files were
+# rendered by fmt::format, so the output of every spec must match them.
+#   cmake -DBINARY=<path> -P format.cmake
+
+if (NOT BINARY)
+  message(FATAL_ERROR "Expected -DBINARY=<path>")
+endif()
+
+set(data ${CMAKE_CURRENT_LIST_DIR}/data)
+
+set(formats
+  "{addr:08X}  {instr:08X}  {mnemonic}"
+  "{addr:#010x} {instr:>12X} | {mnemonic:<24}|"
+  "{addr:*^12X} {instr:<012x} {instr:^#14o} {mnemonic:>28} {{{addr:d}}}"
+  "{addr:#b} {instr:_>#40b} {mnemonic:-^20s}"
+  "{addr:08X} {mnemonic:.6}|{instr:x}")
+
+foreach (mode arm thumb)
+  set(args "")
+  if (mode STREQUAL "thumb")
+    set(args -t)
+  endif()
+
+  set(index 0)
+  foreach (format ${formats})
+    set(expected ${data}/format-${mode}-${index}.txt)
+
+    execute_process(
+      COMMAND ${BINARY} ${args} -b 0x8000000 -f "${format}" ${data}/${mode}.bin format.txt
+      RESULT_VARIABLE result
+      OUTPUT_VARIABLE output
+      ERROR_VARIABLE output)
+
+    if (NOT result EQUAL 0)
+      message(SEND_ERROR "${mode} '${format}': failed with ${result}: ${output}")
+    else()
+      file(READ format.txt actual)
+      file(READ ${expected} wanted)
+      if (NOT actual STREQUAL wanted)
+        message(SEND_ERROR "${mode} '${format}': output differs from ${expected}")
+      endif()
+    endif()
+
+    math(EXPR index "${index} + 1")
+  endforeach()
+endforeach()
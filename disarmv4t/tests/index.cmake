@@ -0,0 +1,78 @@
+# Writes an index for inputs spanning several 256 KiB chunks and checks that
+# every entry points at the line of its address in the listing. The Thumb
+# tile places a long branch pair across every chunk boundary.
+#   cmake -DBINARY=<path> -P index.cmake
+
+if (NOT BINARY)
+  message(FATAL_ERROR "Expected -DBINARY=<path>")
+endif()
+
+set(data ${CMAKE_CURRENT_LIST_DIR}/data)
+
+foreach (mode arm thumb)
+  set(args "")
+  set(width 4)
+  if (mode STREQUAL "thumb")
+    set(args -t)
+    set(width 2)
+  endif()
+
+  # 2^11 tiles of 256 bytes fill two chunks, one more tile starts a third
+  configure_file(${data}/${mode}.bin index-${mode}.bin COPYONLY)
+  foreach (step RANGE 10)
+    execute_process(COMMAND ${CMAKE_COMMAND} -E cat index-${mode}.bin index-${mode}.bin OUTPUT_FILE index.tmp)
+    file(RENAME index.tmp index-${mode}.bin)
+  endforeach()
+  execute_process(COMMAND ${CMAKE_COMMAND} -E cat index-${mode}.bin ${data}/${mode}.bin OUTPUT_FILE index.tmp)
+  file(RENAME index.tmp index-${mode}.bin)
+
+  # An odd interval lands on both halves of long branch pairs
+  set(interval 999)
+  execute_process(
+    COMMAND ${BINARY} ${args} -b 0x8000000 -i ${interval} index-${mode}.bin index.txt
+    RESULT_VARIABLE result
+    OUTPUT_VARIABLE output
+    ERROR_VARIABLE output)
+
+  if (NOT result EQUAL 0)
+    message(SEND_ERROR "${mode}: failed with ${result}: ${output}")
+    continue()
+  endif()
+
+  file(STRINGS index.txt.idx entries)
+
+  file(SIZE index-${mode}.bin size)
+  math(EXPR expected "(${size} / ${width} - 1) / ${interval} + 1")
+  list(LENGTH entries count)
+  if (NOT count EQUAL expected)
+    message(SEND_ERROR "${mode}: expected ${expected} entries, got ${count}")
+  endif()
+
+  set(previous -1)
+  foreach (entry ${entries})
+    string(SUBSTRING "${entry}" 0 8 addr)
+    string(SUBSTRING "${entry}" 9 16 offset)
+    math(EXPR offset "0x${offset}")
+
+    if (NOT offset GREATER previous)
+      message(SEND_ERROR "${mode} ${addr}: offset ${offset} does not increase")
+    endif()
+    set(previous ${offset})
+
+    # Lines start after a line break and with their address
+    set(start ${offset})
+    set(line "\n")
+    if (offset GREATER 0)
+      math(EXPR start "${offset} - 1")
+      set(line "")
+    endif()
+    file(READ index.txt read OFFSET ${start} LIMIT 9)
+    string(APPEND line "${read}")
+    string(SUBSTRING "${line}" 0 1 before)
+    string(SUBSTRING "${line}" 1 8 line)
+
+    if (NOT line STREQUAL addr OR NOT before STREQUAL "\n")
+      message(SEND_ERROR "${mode} ${addr}: offset ${offset} points at '${line}'")
+    endif()
+  endforeach()
+endforeach()
@@ -0,0 +1,66 @@
+# Lists inputs spanning several 256 KiB chunks with --parallel, --pipeline
+# and --regions and compares them with the plain listing. The inputs repeat
+# the tiles in data, the Thumb tile places a long branch pair across every
+# chunk boundary, and an odd tail pads the last instruction.
+#   cmake -DBINARY=<path> -P listing.cmake
+
+if (NOT BINARY)
+  message(FATAL_ERROR "Expected -DBINARY=<path>")
+endif()
+
+set(data ${CMAKE_CURRENT_LIST_DIR}/data)
+
+function(run)
+  execute_process(
+    COMMAND ${BINARY} ${ARGN}
+    RESULT_VARIABLE result
+    OUTPUT_VARIABLE output
+    ERROR_VARIABLE output)
+
+  if (NOT result EQUAL 0)
+    message(SEND_ERROR "${ARGN}: failed with ${result}: ${output}")
+  endif()
+endfunction()
+
+function(compare name file expected)
+  file(READ ${file} actual)
+  if (NOT actual STREQUAL expected)
+    message(SEND_ERROR "${name}: output differs from the plain listing")
+  endif()
+endfunction()
+
+foreach (mode arm thumb)
+  set(args "")
+  if (mode STREQUAL "thumb")
+    set(args -t)
+  endif()
+
+  # 2^11 tiles of 256 bytes fill two chunks, one more tile starts a third
+  configure_file(${data}/${mode}.bin ${mode}.bin COPYONLY)
+  foreach (step RANGE 10)
+    execute_process(COMMAND ${CMAKE_COMMAND} -E cat ${mode}.bin ${mode}.bin OUTPUT_FILE ${mode}.tmp)
+    file(RENAME ${mode}.tmp ${mode}.bin)
+  endforeach()
+  execute_process(COMMAND ${CMAKE_COMMAND} -E cat ${mode}.bin ${data}/${mode}.bin OUTPUT_FILE ${mode}.tmp)
+  file(RENAME ${mode}.tmp ${mode}.bin)
+  file(APPEND ${mode}.bin "abc")
+
+  run(${args} -b 0x8000000 ${mode}.bin plain.txt)
+  file(READ plain.txt plain)
+
+  run(${args} -b 0x8000000 --parallel ${mode}.bin parallel.txt)
+  compare("${mode} --parallel" parallel.txt "${plain}")
+
+  run(${args} -b 0x8000000 --pipeline ${mode}.bin pipeline.txt)
+  compare("${mode} --pipeline" pipeline.txt "${plain}")
+
+  # Regions start with a header and end with an empty line
+  file(WRITE listing.map "0 0 0x8000000 ${mode}\n")
+  run(--regions listing.map ${mode}.bin regions.txt)
+  file(READ regions.txt regions)
+  string(FIND "${regions}" "\n" header)
+  math(EXPR header "${header} + 1")
+  string(SUBSTRING "${regions}" ${header} -1 regions)
+  file(WRITE regions.txt "${regions}")
+  compare("${mode} --regions" regions.txt "${plain}\n")
+endforeach()
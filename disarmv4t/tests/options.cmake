@@ -0,0 +1,109 @@
+# Runs every mode with every option and every other mode. Pairs the mode does
+# not read must be rejected with the usage error, the others must be accepted.
+#   cmake -DBINARY=<path> -P options.cmake
+
+if (NOT BINARY)
+  message(FATAL_ERROR "Expected -DBINARY=<path>")
+endif()
+
+file(WRITE in.bin "0000")
+file(WRITE manifest.txt "")
+file(WRITE regions.map "0 0 0 arm\n")
+file(WRITE annotations.txt "0 label start\n")
+file(REMOVE annotations.db)
+
+set(modes serve batch annotate view counters regions watch trace pipeline parallel cfg functions)
+
+set(serve_args     -s test.sock)
+set(batch_args     -a manifest.txt)
+set(annotate_args  -e annotations.txt)
+set(view_args      -v)
+set(counters_args  -k)
+set(regions_args   -m regions.map)
+set(watch_args     -w)
+set(trace_args     -r)
+set(pipeline_args  -l)
+set(parallel_args  -j)
+set(cfg_args       -g dot)
+set(functions_args -n)
+
+set(serve_reads     format)
+set(batch_reads     format compress)
+set(annotate_reads  annotations)
+set(view_reads      base thumb format)
+set(counters_reads  base thumb format decompress)
+set(regions_reads   format compress)
+set(watch_reads     base thumb format)
+set(trace_reads     format compress decompress)
+set(pipeline_reads  base thumb format compress decompress annotations)
+set(parallel_reads  base thumb format decompress data annotations)
+set(cfg_reads       base thumb compress decompress)
+set(functions_reads base thumb format compress decompress)
+
+set(options base thumb format compress decompress cycles index data profile annotations)
+
+set(base_args        -b 4)
+set(thumb_args       -t)
+set(format_args      -f {addr})
+set(compress_args    -c gzip)
+set(decompress_args  -u none)
+set(cycles_args      -y rom)
+set(index_args       -i 4)
+set(data_args        -d 50)
+set(profile_args     -p)
+set(annotations_args -o annotations.db)
+
+# Modes that keep running are stopped by the timeout
+function(run expect first second)
+  execute_process(
+    COMMAND ${BINARY} ${ARGN} in.bin out.txt
+    RESULT_VARIABLE result
+    OUTPUT_VARIABLE output
+    ERROR_VARIABLE output
+    TIMEOUT 1)
+
+  set(message "Cannot combine --${first} with --${second}")
+  string(FIND "${output}" "${message}" found)
+  if (expect AND (found EQUAL -1 OR NOT result EQUAL 3))
+    message(SEND_ERROR "--${first} --${second}: expected '${message}' and 3, got ${result}")
+  elseif (NOT expect AND output MATCHES "Cannot combine")
+    message(SEND_ERROR "--${first} --${second}: unexpectedly rejected")
+  endif()
+endfunction()
+
+foreach (mode ${modes})
+  foreach (option ${options})
+    list(FIND ${mode}_reads ${option} reads)
+    if (reads EQUAL -1)
+      run(TRUE ${mode} ${option} ${${mode}_args} ${${option}_args})
+    else()
+      run(FALSE ${mode} ${option} ${${mode}_args} ${${option}_args})
+    endif()
+  endforeach()
+endforeach()
+
+set(seen "")
+foreach (mode ${modes})
+  foreach (other ${seen})
+    run(TRUE ${other} ${mode} ${${other}_args} ${${mode}_args})
+  endforeach()
+  list(APPEND seen ${mode})
+endforeach()
+
+# Options that exclude each other in every mode, including the plain listing
+run(TRUE index compress ${index_args} ${compress_args})
+
+# Bad compression specs are rejected before the output is opened
+foreach (spec ":5" ":" "gzip:" "gzip:10" "gzip:1x" "lz4")
+  file(WRITE out.txt "keep")
+  execute_process(
+    COMMAND ${BINARY} -c ${spec} in.bin out.txt
+    RESULT_VARIABLE result
+    OUTPUT_QUIET
+    ERROR_QUIET)
+
+  file(READ out.txt kept)
+  if (NOT result EQUAL 3 OR NOT kept STREQUAL "keep")
+    message(SEND_ERROR "-c ${spec}: expected 3 and the output kept, got ${result}")
+  endif()
+endforeach()
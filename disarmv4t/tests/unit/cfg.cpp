@@ -0,0 +1,46 @@
+#include <vector>
+
+#include "cfg.h"
+#include "check.h"
+
+// Blocks 08000000, 08000008 (branch target) and 08000010 (after the branch)
+static void findBlocks()
+{
+    const std::vector<u8> data = {
+        0x01, 0x00, 0xA0, 0xE3,  // mov r0,0x1
+        0x02, 0x10, 0xA0, 0xE3,  // mov r1,0x2
+        0x01, 0x00, 0x50, 0xE2,  // subs r0,r0,0x1
+        0xFD, 0xFF, 0xFF, 0x1A,  // bne 0x8000008
+        0x1E, 0xFF, 0x2F, 0xE1   // bx lr
+    };
+
+    Cfg cfg(data.data(), data.size(), 0x8000000, false);
+
+    CHECK(cfg.find(0x8000000) == 0);
+    CHECK(cfg.find(0x8000004) == 0);
+    CHECK(cfg.find(0x8000008) == 1);
+    CHECK(cfg.find(0x800000B) == 1);
+    CHECK(cfg.find(0x800000C) == 1);
+    CHECK(cfg.find(0x8000010) == 2);
+    CHECK(cfg.find(0x8000013) == 2);
+
+    CHECK(cfg.find(0x7FFFFFC) == Cfg::npos);
+    CHECK(cfg.find(0x8000014) == Cfg::npos);
+
+    CHECK(cfg.startsBlock(0x8000008));
+    CHECK(!cfg.startsBlock(0x8000004));
+}
+
+static void findEmpty()
+{
+    Cfg cfg(nullptr, 0, 0x8000000, true);
+
+    CHECK(cfg.find(0x8000000) == Cfg::npos);
+}
+
+int main()
+{
+    findBlocks();
+    findEmpty();
+    return failures;
+}
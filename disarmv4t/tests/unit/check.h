@@ -0,0 +1,17 @@
+#pragma once
+
+#include <shell/fmt.h>
+
+// Counts failed checks, main returns the count so ctest sees failures
+inline int failures = 0;
+
+#define CHECK(condition)                                                \
+    do                                                                  \
+    {                                                                   \
+        if (!(condition))                                               \
+        {                                                               \
+            fmt::print("{}:{}: {}\n", __FILE__, __LINE__, #condition);  \
+            failures++;                                                 \
+        }                                                               \
+    }                                                                   \
+    while (false)
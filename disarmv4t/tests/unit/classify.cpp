@@ -0,0 +1,87 @@
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "classify.h"
+#include "listing.h"
+
+static constexpr u32 kBase = 0x8000000;
+static constexpr uint kThreshold = 25;
+
+// A window of Thumb halfwords built from a pattern and a varying low byte,
+// which keeps the entropy of the window high
+template<typename Pattern>
+static std::vector<u8> window(Pattern pattern)
+{
+    std::vector<u8> data;
+    for (uint x = 0; x < DataMap::kWindowSize / 2; ++x)
+    {
+        u16 instr = pattern(x);
+        data.push_back(static_cast<u8>(instr));
+        data.push_back(static_cast<u8>(instr >> 8));
+    }
+    return data;
+}
+
+static bool isData(const std::vector<u8>& data)
+{
+    DataMap map(data.data(), data.size(), kBase, true, kThreshold);
+    return map.isData(kBase);
+}
+
+static void thumbWindows()
+{
+    // mov rN,imm with varying registers and immediates
+    CHECK(!isData(window([](uint x) { return 0x2000 | (x % 8) << 8 | (x * 37 & 0xFF); })));
+
+    // Long branch pairs
+    CHECK(!isData(window([](uint x) { return (x % 2 ? 0xF800 : 0xF000) | (x * 37 & 0xFF); })));
+
+    // Conditional branches with the al condition
+    CHECK(isData(window([](uint x) { return 0xDE00 | (x * 37 & 0xFF); })));
+
+    // Second long branch halves without first ones
+    CHECK(isData(window([](uint x) { return 0xF800 | (x * 37 & 0xFF); })));
+
+    // First long branch halves without second ones
+    CHECK(isData(window([](uint x) { return 0xF000 | (x * 37 & 0xFF); })));
+
+    // Push, pop, ldmia and stmia with empty register lists, mixed with code
+    CHECK(isData(window([](uint x)
+    {
+        static constexpr u16 kEmpty[] = { 0xB400, 0xBC00, 0xC800, 0xC000 };
+        return x % 2 ? kEmpty[x / 2 % 4] : 0x2000 | (x * 37 & 0xFF);
+    })));
+}
+
+// Data windows are listed as .hword lines, code windows are decoded
+static void listDataWindows()
+{
+    auto data = window([](uint x) { return 0x2000 | (x % 8) << 8 | (x * 37 & 0xFF); });
+    auto fill = window([](uint x) { return 0xDE00 | (x * 37 & 0xFF); });
+    data.insert(data.end(), fill.begin(), fill.end());
+
+    DataMap map(data.data(), data.size(), kBase, true, kThreshold);
+    CHECK(!map.isData(kBase));
+    CHECK(map.isData(kBase + DataMap::kWindowSize));
+    CHECK(map.windowEnd(kBase + 2) == kBase + DataMap::kWindowSize);
+
+    ListingHooks hooks;
+    hooks.data = &map;
+
+    u32 lr = 0;
+    std::string text;
+    listing(text, Format("{mnemonic}"), data.data(), data.size(), kBase, true, lr, hooks);
+
+    CHECK(text.find("mov       r0,0x0\n") == 0);
+    CHECK(text.find(".hword") == text.find("\n.hword") + 1);
+    CHECK(text.find("\n.hword    0xDE00\n") != std::string::npos);
+    CHECK(text.find("mov", text.find(".hword")) == std::string::npos);
+}
+
+int main()
+{
+    thumbWindows();
+    listDataWindows();
+    return failures;
+}
@@ -0,0 +1,70 @@
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "context.h"
+
+static const Format kFormat(kDefaultFormat);
+
+// A Thumb long branch pair split between two feeds, with the context
+// serialized in between and resumed from the bytes
+static void resumeLongBranch()
+{
+    const std::vector<u8> data = {
+        0x01, 0x20,  // mov r0,0x1
+        0x00, 0xF0,  // bl high
+        0x01, 0xF8,  // bl low
+        0x70, 0x47   // bx lr
+    };
+
+    std::string whole;
+    DisasmContext context(0x8000000, true);
+    context.feed(whole, kFormat, data.data(), data.size());
+    context.finish(whole, kFormat);
+
+    // The first feed also ends inside the low half
+    std::string split;
+    DisasmContext first(0x8000000, true);
+    first.feed(split, kFormat, data.data(), 5);
+
+    const auto bytes = first.serialize();
+    CHECK(bytes[0] == 0x04 && bytes[1] == 0x00 && bytes[2] == 0x00 && bytes[3] == 0x08);
+    CHECK(bytes[8] == 1);
+    CHECK(bytes[9] == 1);
+    CHECK(bytes[10] == 0x01);
+
+    DisasmContext second;
+    CHECK(DisasmContext::deserialize(bytes, second));
+    CHECK(second.isThumb());
+    CHECK(second.address() == 0x8000004);
+
+    second.feed(split, kFormat, data.data() + 5, data.size() - 5);
+    second.finish(split, kFormat);
+
+    CHECK(split == whole);
+    CHECK(whole.find("bl        0x8000008") != std::string::npos);
+}
+
+static void rejectBadState()
+{
+    DisasmContext::Serialized bytes = {};
+    DisasmContext context;
+
+    bytes[8] = 2;
+    CHECK(!DisasmContext::deserialize(bytes, context));
+
+    bytes[8] = 1;
+    bytes[9] = 2;
+    CHECK(!DisasmContext::deserialize(bytes, context));
+
+    bytes[8] = 0;
+    bytes[9] = 3;
+    CHECK(DisasmContext::deserialize(bytes, context));
+}
+
+int main()
+{
+    resumeLongBranch();
+    rejectBadState();
+    return failures;
+}
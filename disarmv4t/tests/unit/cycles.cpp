@@ -0,0 +1,38 @@
+#include "check.h"
+#include "cycles.h"
+
+static bool equals(const Cycles& cycles, uint s, uint n, uint i, bool branch)
+{
+    return cycles.s == s && cycles.n == n && cycles.i == i && cycles.branch == branch;
+}
+
+// Undefined and coprocessor instructions take the undefined instruction trap,
+// software interrupts branch to their vector
+static void traps()
+{
+    CHECK(equals(cycles(u32(0xE7F000F0)), 2, 1, 1, true));  // undefined
+    CHECK(equals(cycles(u32(0xEE000000)), 2, 1, 1, true));  // cdp
+    CHECK(equals(cycles(u32(0xED900000)), 2, 1, 1, true));  // ldc
+    CHECK(equals(cycles(u32(0xEE000010)), 2, 1, 1, true));  // mcr
+    CHECK(equals(cycles(u32(0xEF000000)), 2, 1, 0, true));  // swi
+
+    CHECK(equals(cycles(u16(0xDE00)), 2, 1, 1, true));  // undefined
+    CHECK(equals(cycles(u16(0xDF00)), 2, 1, 0, true));  // swi
+    CHECK(equals(cycles(u16(0xE000)), 2, 1, 0, true));  // b
+}
+
+// A failed condition only costs the fetch
+static void conditional()
+{
+    Cycles cost = cycles(u32(0x1E000000));  // cdpne
+    CHECK(cost.conditional);
+    CHECK(cost.min(8, 6) == 6);
+    CHECK(cost.max(8, 6) == 21);
+}
+
+int main()
+{
+    traps();
+    conditional();
+    return failures;
+}
@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "check.h"
+#include "listing.h"
+#include "server.h"
+
+static const char* kSocket = "serve.sock";
+
+static const Format kFormat(kDefaultFormat);
+static const Format kFieldsFormat("{addr:08X}\t{instr:08X}\t{mnemonic}");
+
+static std::string expect(const Format& format, std::vector<u8> data, u32 addr, bool thumb)
+{
+    u32 lr = 0;
+    std::string text;
+    listing(text, format, data.data(), data.size(), addr, thumb, lr);
+    return fmt::format("ok {}\n{}", std::count(text.begin(), text.end(), '\n'), text);
+}
+
+static int connect()
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    std::string(kSocket).copy(address.sun_path, sizeof(address.sun_path) - 1);
+
+    // The server binds its socket on another thread
+    for (int attempt = 0; attempt < 500; ++attempt)
+    {
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0)
+            return fd;
+
+        ::close(fd);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return -1;
+}
+
+static std::string exchange(int fd, const std::string& batch)
+{
+    CHECK(::send(fd, batch.data(), batch.size(), 0) == static_cast<ssize_t>(batch.size()));
+
+    std::string response;
+    char chunk[4096];
+    while (response.size() < 2 || response.compare(response.size() - 2, 2, "\n\n") != 0)
+    {
+        ssize_t count = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (count <= 0)
+            break;
+
+        response.append(chunk, count);
+    }
+    return response;
+}
+
+// Sends a batch with padded hex and file ranges and a bad base, then stops
+// the server with SIGTERM and checks that it removed its socket
+static void roundTrip()
+{
+    ::unlink(kSocket);
+
+    std::ofstream("serve.bin", std::ios::binary).write("\x01\x00\xA0\xE3\x02\x10", 6);
+
+    int result = -1;
+    std::thread server([&result]()
+    {
+        result = serve(kSocket, kFormat);
+    });
+
+    int fd = connect();
+    CHECK(fd >= 0);
+    if (fd >= 0)
+    {
+        const auto response = exchange(fd,
+            "fields arm 0x8000000 hex 0100A0E3\n"
+            "fields thumb 0x8000000 hex 012000\n"
+            "text arm 0x100 file 0 0 serve.bin\n"
+            "text arm -1 file 0 0 missing.bin\n"
+            "\n");
+
+        const auto expected =
+            expect(kFieldsFormat, { 0x01, 0x00, 0xA0, 0xE3 }, 0x8000000, false) +
+            expect(kFieldsFormat, { 0x01, 0x20, 0x00, 0x00 }, 0x8000000, true) +
+            expect(kFormat, { 0x01, 0x00, 0xA0, 0xE3, 0x02, 0x10, 0x00, 0x00 }, 0x100, false) +
+            "error bad base -1\n"
+            "\n";
+
+        CHECK(response == expected);
+        ::close(fd);
+    }
+
+    std::raise(SIGTERM);
+    server.join();
+
+    CHECK(result == 0);
+    CHECK(::access(kSocket, F_OK) != 0);
+}
+
+int main()
+{
+    roundTrip();
+    return failures;
+}
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "listing.h"
+#include "trace.h"
+
+static const Format kFormat(kDefaultFormat);
+
+static constexpr u32 kThumb = 0x8000000;
+
+// Shares the cache slot of kThumb
+static constexpr u32 kArm = 0x8020000;
+
+// Thumb loop with a long branch pair and ARM code
+static const std::vector<u8> kThumbCode = {
+    0x01, 0x20,  // mov r0,0x1
+    0x00, 0xF0,  // bl high
+    0x04, 0xF8,  // bl low
+    0x01, 0x38,  // sub r0,0x1
+    0xFA, 0xE7   // b 0x8000000
+};
+
+// The same loop after writing its branch target and sub instruction, the
+// second long branch half keeps its encoding but not its target
+static const std::vector<u8> kPatchedCode = {
+    0x01, 0x20,  // mov r0,0x1
+    0x01, 0xF0,  // bl high
+    0x04, 0xF8,  // bl low
+    0x02, 0x38,  // sub r0,0x2
+    0xFA, 0xE7   // b 0x8000000
+};
+
+static const std::vector<u8> kArmCode = {
+    0x01, 0x00, 0xA0, 0xE3,  // mov r0,0x1
+    0x1E, 0xFF, 0x2F, 0xE1   // bx lr
+};
+
+// Lines of the uncached listing by address
+static std::map<u32, std::string> lines(const std::vector<u8>& code, u32 addr, bool thumb)
+{
+    u32 lr = 0;
+    std::string text;
+    listing(text, kFormat, code.data(), code.size(), addr, thumb, lr);
+
+    std::map<u32, std::string> lines;
+    std::size_t begin = 0;
+    for (u32 pc = addr; begin < text.size(); pc += thumb ? 2 : 4)
+    {
+        std::size_t end = text.find('\n', begin) + 1;
+        lines[pc] = text.substr(begin, end - begin);
+        begin = end;
+    }
+    return lines;
+}
+
+static void append(std::vector<u8>& trace, u32 pc, u32 instr)
+{
+    for (u32 value : { pc, instr })
+    {
+        for (uint x = 0; x < 4; ++x)
+            trace.push_back(static_cast<u8>(value >> (8 * x)));
+    }
+}
+
+// Runs the loop many times, patches it, and alternates with ARM code in the
+// same cache slot. Every line must match the uncached listing.
+static void hotLoop()
+{
+    const auto thumb   = lines(kThumbCode, kThumb, true);
+    const auto patched = lines(kPatchedCode, kThumb, true);
+    const auto arm     = lines(kArmCode, kArm, false);
+
+    std::vector<u8> trace;
+    std::string expected;
+    for (uint iteration = 0; iteration < 100; ++iteration)
+    {
+        const auto& code  = iteration < 50 ? kThumbCode : kPatchedCode;
+        const auto& lines = iteration < 50 ? thumb : patched;
+        for (u32 offset = 0; offset < code.size(); offset += 2)
+        {
+            append(trace, (kThumb + offset) | 0x1, code[offset] | code[offset + 1] << 8);
+            expected.append(lines.at(kThumb + offset));
+        }
+
+        if (iteration % 10 == 0)
+        {
+            for (u32 offset = 0; offset < kArmCode.size(); offset += 4)
+            {
+                u32 instr = kArmCode[offset] | kArmCode[offset + 1] << 8 | kArmCode[offset + 2] << 16 | kArmCode[offset + 3] << 24;
+                append(trace, kArm + offset, instr);
+                expected.append(arm.at(kArm + offset));
+            }
+        }
+    }
+
+    std::string whole;
+    Trace first(kFormat);
+    first.render(whole, trace.data(), trace.size());
+    CHECK(first.finish());
+    CHECK(whole == expected);
+
+    // Chunks that split records render the same lines
+    std::string split;
+    Trace second(kFormat);
+    for (std::size_t offset = 0; offset < trace.size(); offset += 11)
+        second.render(split, trace.data() + offset, std::min<std::size_t>(11, trace.size() - offset));
+    CHECK(second.finish());
+    CHECK(split == expected);
+}
+
+static void incompleteRecord()
+{
+    std::vector<u8> trace;
+    append(trace, kArm, 0xE3A00001);
+    trace.resize(trace.size() + 5);
+
+    std::string text;
+    Trace partial(kFormat);
+    partial.render(text, trace.data(), trace.size());
+    CHECK(!partial.finish());
+    CHECK(text == lines(kArmCode, kArm, false).at(kArm));
+}
+
+int main()
+{
+    hotLoop();
+    incompleteRecord();
+    return failures;
+}
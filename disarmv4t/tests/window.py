@@ -0,0 +1,60 @@
+# Steps a Window across Thumb code with a long branch pair and writes to its
+# memory. Checks the lines against disassemble and the number of lines each
+# update renders.
+#   python window.py <module directory>
+
+import struct
+import sys
+
+sys.path.insert(0, sys.argv[1])
+
+import disarmv4t
+
+base = 0x8000000
+memory = bytearray(struct.pack("<10H",
+    0x2001, 0x2102, 0x46C0, 0x46C0, 0xF000, 0xF801, 0x4770, 0x46C0, 0x46C0, 0x46C0))
+
+window = disarmv4t.Window(2, 2)
+failed = False
+
+def step(pc, rendered):
+    global failed
+
+    actual = window.update(memory, base, pc, thumb=True)
+    if actual != rendered:
+        print(f"pc {pc:08X}: rendered {actual} lines, expected {rendered}")
+        failed = True
+
+    expected = [
+        (addr, instr, True, mnemonic)
+        for addr, instr, mnemonic in disarmv4t.disassemble(memory, base=base, thumb=True)
+        if pc - 4 <= addr <= pc + 4
+    ]
+    if window.lines() != expected:
+        print(f"pc {pc:08X}: lines {window.lines()}, expected {expected}")
+        failed = True
+
+step(base + 4, 5)
+step(base + 4, 0)
+
+# One line scrolls in, including both halves of the long branch
+step(base + 6, 1)
+step(base + 8, 1)
+step(base + 10, 1)
+
+# Writing the first half changes both lines of the pair
+memory[8:10] = struct.pack("<H", 0xF001)
+step(base + 10, 2)
+
+# Two lines scroll in, lines outside of the memory are left out
+step(base + 18, 2)
+
+for value in (-1, 2 ** 33):
+    try:
+        window.update(memory, base, value)
+        print(f"pc {value} was accepted")
+        failed = True
+    except ValueError:
+        pass
+
+sys.exit(1 if failed else 0)